@@ -0,0 +1,280 @@
+/**
+ * Copyright (C) 2023 Ryan Instrell - All rights reserved.
+ *
+ * usage: ./vigenere-bench [-h] [--max-size BYTES] [--min-time MS] [-j N] [--json FILE]
+ *
+ * Measures the throughput (MB/s and cycles/byte) of each kernel across message
+ * sizes (16 B - 1 GiB), key lengths (1 - 4096) and alphabetic densities (0% - 100%).
+ */
+
+/**
+* Provides functions to interact with the i/o streams.
+* those used within this program: printf(), fprintf(), fopen(), fclose(), fflush()
+*
+* https://cplusplus.com/reference/cstdio/
+*/
+#include <stdio.h>
+
+/**
+* Provides functions to interact with strings and arrays.
+* those used within this program: strncmp()
+*
+* https://cplusplus.com/reference/cstring/
+*/
+#include <string.h>
+
+/**
+* Provides functions to achieve various activities.
+* utilities used within this program: malloc(), free(), strtoull(), atof(), atoi(),
+* EXIT_SUCCESS, EXIT_FAILURE
+*
+* https://cplusplus.com/reference/cstdlib/
+*/
+#include <stdlib.h>
+
+/**
+* Provides the kernels (libvigenere), which are selected by name.
+* those used within this program: vigenere_kernel(), vigenere_kernel_name(),
+* vigenere_use_kernel(), vigenere_fill_shifts(), vigenere_transform(),
+* vigenere_transform_parallel()
+*/
+#include "vigenere.h"
+
+/**
+* Provides __rdtsc() (x86 only), used to count cycles.
+*
+* https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html
+*/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BENCH_RDTSC
+#include <x86intrin.h>
+#endif
+
+/**
+* Provides functions to interact with time.
+* those used within this program: clock_gettime(), timespec_get()
+*
+* https://en.cppreference.com/w/c/chrono
+*/
+#include <time.h>
+
+// The smallest and largest message sizes measured (16 B and 1 GiB respectively).
+#define MIN_BENCH_SIZE ((size_t)16)
+#define MAX_BENCH_SIZE ((size_t)1 << 30)
+
+/**
+ * The minimum duration (in milliseconds) for which each configuration is measured,
+ * whereby the transformation is repeated until this has elapsed. This reduces the
+ * influence of timer resolution upon small messages.
+ */
+#define DEFAULT_MIN_TIME_MS 100
+
+/**
+ * Stores a kernel to be measured - each of the kernels supported by libvigenere
+ * (including the original ctype.h-based loop, which serves as the baseline).
+ *
+ * threads is greater than one for the threaded kernel (see vigenere_transform_parallel()),
+ * which uses the kernel automatically selected by the library.
+ */
+typedef struct bench_kernel {
+  const char *name;
+  int threads;
+} bench_kernel_t;
+
+// The key lengths and alphabetic densities (percentages) measured for each size.
+static const size_t key_lengths[] = { 1, 16, 256, 4096 };
+static const int densities[] = { 0, 25, 50, 75, 100 };
+
+/**
+ * Returns the current time in seconds, using a monotonic clock where available
+ * (POSIX), so that the measurements are unaffected by adjustments to the system time.
+ */
+static double
+now_seconds(void) {
+  struct timespec now;
+
+#ifndef _WIN32
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  timespec_get(&now, TIME_UTC);
+#endif
+
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the processor's timestamp counter (x86 only), used to report cycles/byte.
+ * Elsewhere, 0 is returned, and cycles/byte is reported as null.
+ *
+ * Note: the timestamp counter ticks at a constant (nominal) frequency on modern
+ * processors, hence these are nominal cycles as opposed to core clock cycles.
+ */
+static unsigned long long
+read_cycles(void) {
+#ifdef BENCH_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Fills text with text_len pseudo-random characters, of which (approximately) density
+ * percent are alphabetic, and the remainder are punctuation, digits or whitespace.
+ *
+ * A xorshift generator is used so that the data (and thus the results) are identical
+ * across runs and platforms.
+ *
+ * https://en.wikipedia.org/wiki/Xorshift
+ */
+static void
+fill_text(char *text, size_t text_len, int density) {
+  static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ",
+                    others[] = " .,;:!?'-0123456789\n";
+  unsigned long long state = 0x9E3779B97F4A7C15ULL;
+
+  for (size_t text_ctr = 0; text_ctr < text_len; text_ctr++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    text[text_ctr] = (int)(state % 100) < density
+      ? letters[(state >> 8) % (sizeof(letters) - 1)]
+      : others[(state >> 8) % (sizeof(others) - 1)];
+  }
+}
+
+// Prints the usage information, and exits.
+static void
+exit_print_bench_usage(void) {
+  fprintf(stderr, "usage: ./vigenere-bench [-h] [--max-size BYTES] [--min-time MS] [-j N] [--json FILE]\n\n\
+      --max-size  the largest message size to measure (default = 1 GiB).\n\
+      --min-time  the minimum duration of each measurement, in milliseconds (default = 100).\n\
+      -j          the number of threads used by the threaded kernel (default = 4).\n\
+      --json      writes the results as JSON to FILE (\"-\" = stdout, replacing the table).\n\
+      -h          displays help message and usage information.\n\n");
+  exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char **argv) {
+  size_t max_size = MAX_BENCH_SIZE;
+  double min_time = DEFAULT_MIN_TIME_MS / 1000.0;
+  int threads = 4;
+  const char *json_path = NULL;
+
+  for (int arg_ctr = 1; arg_ctr < argc; arg_ctr++) {
+    if (arg_ctr + 1 >= argc) exit_print_bench_usage();
+
+    if (strncmp(argv[arg_ctr], "--max-size", 11) == 0) max_size = (size_t)strtoull(argv[++arg_ctr], NULL, 10);
+    else if (strncmp(argv[arg_ctr], "--min-time", 11) == 0) min_time = atof(argv[++arg_ctr]) / 1000.0;
+    else if (strncmp(argv[arg_ctr], "-j", 3) == 0) threads = atoi(argv[++arg_ctr]);
+    else if (strncmp(argv[arg_ctr], "--json", 7) == 0) json_path = argv[++arg_ctr];
+    else exit_print_bench_usage();
+  }
+
+  if (max_size < MIN_BENCH_SIZE || threads < 2 || threads > MAX_THREADS) exit_print_bench_usage();
+
+  // The fastest kernel (selected by the library) is restored for the threaded kernel.
+  const char *best_kernel = vigenere_kernel();
+  bench_kernel_t kernels[16];
+  int kernel_count = 0;
+
+  for (const char *name; kernel_count < 15 && (name = vigenere_kernel_name((size_t)kernel_count)) != NULL;)
+    kernels[kernel_count++] = (bench_kernel_t){ name, 1 };
+  kernels[kernel_count++] = (bench_kernel_t){ "threaded", threads };
+
+  char *text = (char *)malloc(max_size);
+  unsigned char *shifts = (unsigned char *)malloc(key_lengths[sizeof(key_lengths) / sizeof(key_lengths[0]) - 1] + KEY_RING_PADDING);
+  FILE *json = NULL;
+
+  if (text == NULL || shifts == NULL) {
+    fprintf(stderr, "error: unable to allocate %zu bytes (try a smaller --max-size).\n", max_size);
+    return EXIT_FAILURE;
+  }
+
+  if (json_path != NULL && (json = strncmp(json_path, "-", 2) == 0 ? stdout : fopen(json_path, "w")) == NULL) {
+    fprintf(stderr, "error: unable to open '%s' for writing.\n", json_path);
+    return EXIT_FAILURE;
+  }
+
+  if (json != stdout)
+    printf("%-10s %12s %8s %8s %12s %10s\n", "kernel", "size", "key_len", "alpha%", "MB/s", "cycles/B");
+  if (json != NULL) fprintf(json, "[");
+
+  int first_result = 1;
+
+  for (int density_ctr = 0; density_ctr < (int)(sizeof(densities) / sizeof(densities[0])); density_ctr++) {
+    fill_text(text, max_size, densities[density_ctr]);
+
+    for (size_t key_ctr = 0; key_ctr < sizeof(key_lengths) / sizeof(key_lengths[0]); key_ctr++) {
+      const size_t key_len = key_lengths[key_ctr];
+      char *key = (char *)malloc(key_len);
+
+      // A key of the given length, cycling through the alphabet (i.e., "BCDE...").
+      for (size_t char_ctr = 0; char_ctr < key_len; char_ctr++) key[char_ctr] = (char)('A' + (char_ctr + 1) % 26);
+      vigenere_fill_shifts(key, key_len, shifts);
+      free(key);
+
+      for (size_t size = MIN_BENCH_SIZE; size <= max_size; size *= 16) {
+        for (int kernel_ctr = 0; kernel_ctr < kernel_count; kernel_ctr++) {
+          const bench_kernel_t *bench = &kernels[kernel_ctr];
+          key_state_t key_state = { shifts, key_len, 0, Letters, NULL, Vigenere };
+          size_t iterations = 0, batch = 1;
+
+          // The threaded kernel uses the fastest kernel, whereas the others are forced.
+          vigenere_use_kernel(bench->threads > 1 ? best_kernel : bench->name);
+
+          const double start = now_seconds();
+          const unsigned long long start_cycles = read_cycles();
+          double elapsed = 0;
+
+          /**
+          * The clock is only read after each batch of iterations (which doubles in
+          * size), so that reading it does not dominate the measurement of small sizes.
+          */
+          do {
+            for (size_t batch_ctr = 0; batch_ctr < batch; batch_ctr++) {
+              if (bench->threads > 1) vigenere_transform_parallel(text, text, size, &key_state, Encrypt, bench->threads);
+              else vigenere_transform(text, size, &key_state, Encrypt);
+            }
+
+            iterations += batch;
+            batch *= 2;
+          } while ((elapsed = now_seconds() - start) < min_time);
+
+          const double bytes = (double)size * (double)iterations,
+                       throughput = bytes / elapsed / 1e6,
+                       cycles = start_cycles != 0 ? (double)(read_cycles() - start_cycles) / bytes : -1;
+
+          if (json != stdout) {
+            printf("%-10s %12zu %8zu %8d %12.1f ", bench->name, size, key_len, densities[density_ctr], throughput);
+            if (cycles >= 0) printf("%10.3f\n", cycles);
+            else printf("%10s\n", "-");
+            fflush(stdout);
+          }
+
+          if (json != NULL) {
+            fprintf(json, "%s\n  {\"kernel\":\"%s\",\"size\":%zu,\"key_len\":%zu,\"density\":%d,\"mb_per_s\":%.1f,",
+                    first_result ? "" : ",", bench->name, size, key_len, densities[density_ctr], throughput);
+            if (cycles >= 0) fprintf(json, "\"cycles_per_byte\":%.3f}", cycles);
+            else fprintf(json, "\"cycles_per_byte\":null}");
+            first_result = 0;
+          }
+        }
+
+        // The sizes are 16 B, 256 B, 4 KiB, ... - the largest is always measured.
+        if (size < max_size && size * 16 > max_size) size = max_size / 16;
+      }
+    }
+  }
+
+  if (json != NULL) {
+    fprintf(json, "\n]\n");
+    if (json != stdout) fclose(json);
+  }
+
+  free(text);
+  free(shifts);
+  return EXIT_SUCCESS;
+}
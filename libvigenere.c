@@ -0,0 +1,3471 @@
+/**
+ * Copyright (C) 2023 Ryan Instrell - All rights reserved.
+ *
+ * libvigenere - the implementation of the cipher (see vigenere.h).
+ *
+ * This contains the kernels (scalar, SSE4.1, AVX2 and NEON, alongside their constant-time
+ * counterparts), their runtime selection, the threaded transformation (optionally offloaded
+ * to a GPU), the arena, the streaming context and the cryptanalysis (key recovery by
+ * analysis, or by searching a set of keys).
+ */
+
+#include "vigenere.h"
+
+/**
+* Provides functions to interact with strings and arrays.
+* those used within this library: strlen(), strncmp(), memcpy(), memcmp(), memset()
+*
+* https://cplusplus.com/reference/cstring/
+*/
+#include <string.h>
+
+/**
+* Provides integer types of a fixed (or pointer) size.
+* those used within this library: uintptr_t, uint32_t, uint64_t
+*
+* https://cplusplus.com/reference/cstdint/
+*/
+#include <stdint.h>
+
+/**
+* Provides functions to achieve various activities.
+* utilities used within this library: malloc(), calloc(), free()
+*
+* https://cplusplus.com/reference/cstdlib/
+*/
+#include <stdlib.h>
+
+/**
+* Provides functions to interact with characters.
+* those used within this library: isalpha(), isupper(),
+* toupper(), isdigit()
+*
+* https://cplusplus.com/reference/cctype/
+*/
+#include <ctype.h>
+
+/**
+* Provides mathematical functions.
+* those used within this library: log10()
+*
+* https://cplusplus.com/reference/cmath/
+*/
+#include <math.h>
+
+/**
+* Provides functions to create and join threads.
+* those used within this library: pthread_create(), pthread_join(), pthread_mutex_lock(),
+* pthread_mutex_unlock()
+*
+* POSIX threads are unavailable on Windows, whereby vigenere_transform_parallel()
+* transforms the chunks one after another.
+*
+* https://man7.org/linux/man-pages/man7/pthreads.7.html
+*/
+#ifndef _WIN32
+#define VIGENERE_THREADS
+#include <pthread.h>
+#endif
+
+/**
+* Provides the SIMD intrinsics used by the vectorised kernels.
+*
+* On x86, the kernels are compiled using GCC/Clang's target attribute, and
+* selected at runtime (see select_kernel()) - the program therefore still runs
+* on processors without AVX2/SSE4.1. On AArch64, NEON is always available.
+*
+* Other compilers/architectures (i.e., MSVC) fall back to the scalar kernel.
+*
+* https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html
+* https://developer.arm.com/architectures/instruction-sets/intrinsics/
+*/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VIGENERE_X86_SIMD
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define VIGENERE_NEON
+#include <arm_neon.h>
+#endif
+
+/**
+* Provides the OpenCL API, through which the bulk transformations and the searches are
+* offloaded to a GPU (see gpu_open()) - this is only included when compiled with
+* -DVIGENERE_OPENCL (and linked with -lOpenCL), as are the clocks used to decide whether
+* the GPU is faster than the processor.
+* those used within this library: clGetPlatformIDs(), clGetDeviceIDs(), clCreateContext(),
+* clBuildProgram(), clCreateBuffer(), clEnqueueMapBuffer(), clEnqueueWriteBuffer(),
+* clEnqueueNDRangeKernel(), clEnqueueReadBuffer(), clWaitForEvents(), clock_gettime()
+*
+* https://registry.khronos.org/OpenCL/specs/3.0-unified/html/OpenCL_API.html
+* https://man7.org/linux/man-pages/man3/clock_gettime.3.html
+*/
+#ifdef VIGENERE_OPENCL
+#define CL_TARGET_OPENCL_VERSION 120
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+#include <time.h>
+#endif
+
+// Constants used repetitively throughout the source code.
+/**
+ * Defines the modulo space in which the shifts are performed within.
+ *
+ * This restricts the resulting value within the 0-25 range, this ensuring
+ * that the character is alphabetic prior to converting to ASCII.
+ */
+#define CHAR_SPACE 26
+
+/**
+ * After performing the shifts, this value is used to convert the resulting 
+ * value into a valid ASCII, alphabetic character. 
+ */
+#define ASCII_HIGHER_OFFSET 'A'
+
+/**
+* 'a' = 'A' ^ 0x20.
+*
+* This is because the 6th bit of A-Z is always equal to 1, 
+* whereas the 6th bit of a-z is always equal to 0. 
+* 
+* Resultantly, if the 6th bit of an ASCII character is XORed
+* with 32 (base 10) / 20 (base 16), this will effectively 
+* invert the character's case. 
+*/
+#define ASCII_LOWER_OFFSET (ASCII_HIGHER_OFFSET ^ 0x20) // 'a'
+
+/**
+ * Buffers smaller than this are transformed upon the calling thread, as the cost of
+ * creating threads would otherwise outweigh the benefit.
+ */
+#define PARALLEL_MIN_SIZE (256 * 1024)
+
+/**
+ * The most characters a vector advances the key by (that is, the width of an AVX2 vector),
+ * which the ring of shifts walked by the vectorised kernels spans at least (see key_ring_len()).
+ */
+#define KEY_RING_WIDTH 32
+
+/**
+ * Forcibly inlines a function, so that it is specialised for the constants it is called with
+ * (see transform_blocks_sse41() and transform_symbols()).
+ *
+ * https://gcc.gnu.org/onlinedocs/gcc/Common-Function-Attributes.html#index-always_005finline-function-attribute
+ */
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+/**
+ * This function is responsible for performing encryption operations.
+ *
+ * Notice how the text is passed in alongside its length, and is modified
+ * in place - no output buffer is allocated, as each enciphered character
+ * simply replaces the original.
+ *
+ * Furthemore, the key state is passed in as a reference, so that
+ * its position can be advanced (notice use of the '->' notation).
+ */
+static void 
+encrypt(char *text, size_t text_len, key_state_t *key_state) {
+
+  /**
+  * The encryption is performed on ASCII characters, as this is easily printable, and
+  * is significantly more efficient compared to mapping individual characters
+  * to a table of integer values.
+  * 
+  * Futhermore, C allows arithmetic to be easily performed on ASCII values,
+  * as these are treated as both integers and characters. 
+  */ 
+  for (size_t enc_ctr = 0; enc_ctr < text_len; enc_ctr++) {
+    const unsigned char character = (unsigned char)text[enc_ctr];
+
+    /**
+    * This check is performed to preserve any punctuation within the original message.
+    * 
+    * If the character is non-alphabetic, simply keep within the enciphered message
+    * (i.e., it is left untouched).
+    * 
+    * Performed using isalpha() from ctype.h.
+    */ 
+    if (!isalpha(character)) continue;
+
+    /**
+    * Equivalent calculation:
+    * C[i] = ((M[i] - 'A' + K[i]) % 26) + 'A'
+    * 
+    * M[i] is shifted K[i] places, and if C[i] is not within
+    * the alphabetic range (0-25), it will wrap around due to '% 26'.
+    * 
+    * It is also important to note that the Vigenere cipher uses a 26x26 table,
+    * thereby restricting us to the range 0-25.
+    *
+    * K[i] is taken from the shift table produced by generate_keystream(), 
+    * indexed by key_pos, as opposed to a keystream the length of the message.
+    */ 
+    text[enc_ctr] =
+      ((toupper(character) - ASCII_HIGHER_OFFSET + key_state->shifts[key_state->key_pos]) % CHAR_SPACE)
+      
+      /**
+      * + 'A' places the character (uppercase) back within the ASCII character space, as this
+      * would otherwise yield non-printable characters. 'a' would have the same effect, but for
+      * lowercase characters. This helps preserve case.  
+      *
+      * Depending on whether the original value in question was uppercase or lowercase,
+      * the offset's case is inverted.
+      */
+      + (isupper(character) ? ASCII_HIGHER_OFFSET : ASCII_LOWER_OFFSET);
+
+    /**
+    * Only alphabetic characters advance the key position, which wraps around
+    * once the end of the key has been reached (i.e., KEYKE YKEYK).
+    */
+    if (++key_state->key_pos == key_state->key_len) key_state->key_pos = 0;
+  }
+}
+
+// This function is responsible for performing decryption operations (in place).
+static void 
+decrypt(char *text, size_t text_len, key_state_t *key_state) {
+
+  for (size_t dec_ctr = 0; dec_ctr < text_len; dec_ctr++) {
+    const unsigned char character = (unsigned char)text[dec_ctr];
+
+    /**
+    * Similarly, a check using isalpha() is performed to preserve any
+    * punctuation within the original message.
+    */
+    if (!isalpha(character)) continue;
+
+    /**
+    * The calculation is slightly different to encrypt(), whereby we must now
+    * subtract instead of add.
+    *
+    * Equivalent calculation:
+    * M[i] = ((C[i] - 'A' - K[i] + 26) % 26) + 'A'
+    *
+    * In addition, we add 26 to the result of C[i] - K[i] should this be
+    * a non-positive number.
+    */
+    text[dec_ctr] = 
+      ((toupper(character) - ASCII_HIGHER_OFFSET - key_state->shifts[key_state->key_pos]) + CHAR_SPACE) % CHAR_SPACE
+      // Similarly to encryption, 'A'/'a' is added to convert the value to an alphabetic ASCII value. 
+      + (isupper(character) ? ASCII_HIGHER_OFFSET : ASCII_LOWER_OFFSET);
+
+    // Similarly to encryption, only alphabetic characters advance the key.
+    if (++key_state->key_pos == key_state->key_len) key_state->key_pos = 0;
+  }
+}
+
+/**
+ * The operations performed by the kernels, to which each cipher (and mode) reduces:
+ *
+ * Add = M + K (Vigenere/Gronsfeld encryption, variant Beaufort decryption), Subtract = 
+ * M - K (Vigenere/Gronsfeld decryption, variant Beaufort encryption), and Reflect = K - M
+ * (Beaufort, whether encrypting or decrypting). Each kernel is therefore written once,
+ * and parameterised by the operation - the ciphers thus share the same hot path.
+ */
+typedef enum operations { Add = 0, Subtract, Reflect } operations_t;
+
+// Returns the operation performed by the key state's cipher, whilst in the given mode.
+static inline operations_t
+key_operation(const key_state_t *key_state, modes_t mode) {
+  if (key_state->cipher == Beaufort) return Reflect;
+  if (key_state->cipher == VariantBeaufort) return mode == Encrypt ? Subtract : Add;
+  return mode == Encrypt ? Add : Subtract;
+}
+
+/**
+ * Lookup tables used by the scalar (portable) kernel.
+ *
+ * shift_tables[OPERATION][K][c] holds the result of encrypting (OPERATION = Add),
+ * decrypting (OPERATION = Subtract) or reflecting (OPERATION = Reflect) the character c
+ * with the shift K - non-alphabetic characters map to themselves, and case is preserved.
+ *
+ * alpha_table[c] is 1 should c be alphabetic, otherwise 0. This is added to the
+ * key position, as only alphabetic characters advance the key.
+ *
+ * Each table is indexed by an unsigned char, hence 256 entries (3 * 26 * 256 + 256 
+ * bytes in total, which comfortably fits within the L1 cache).
+ */
+static unsigned char shift_tables[3][CHAR_SPACE][256], alpha_table[256];
+
+/**
+ * This function builds the lookup tables, once, prior to the first transformation.
+ *
+ * Each row begins as the identity (as non-alphabetic characters map to themselves), whereby
+ * only the 52 letters are then computed, as encrypt()/decrypt() would (K - M being reflected). 
+ * Producing every entry via encrypt()/decrypt() themselves is an order of magnitude slower -
+ * which, for a short message, is most of the time taken by the whole program.
+ */
+static void
+build_shift_tables(void) {
+  unsigned char identity[256];
+
+  for (int character = 0; character < 256; character++) {
+    identity[character] = (unsigned char)character;
+    alpha_table[character] = isalpha(character) ? 1 : 0;
+  }
+
+  for (int operation = Add; operation <= Reflect; operation++) {
+    for (int shift = 0; shift < CHAR_SPACE; shift++) {
+      unsigned char *row = shift_tables[operation][shift];
+
+      memcpy(row, identity, sizeof(identity));
+
+      for (int letter = 0; letter < CHAR_SPACE; letter++) {
+        const int result = (operation == Add ? letter + shift : 
+                            operation == Subtract ? letter - shift + CHAR_SPACE : shift - letter + CHAR_SPACE) % CHAR_SPACE;
+
+        row[ASCII_HIGHER_OFFSET + letter] = (unsigned char)(ASCII_HIGHER_OFFSET + result);
+        row[ASCII_LOWER_OFFSET + letter] = (unsigned char)(ASCII_LOWER_OFFSET + result);
+      }
+    }
+  }
+}
+
+/**
+ * This function is the scalar (portable) kernel, used on processors without
+ * vector extensions and to transform any bytes remaining after the vectorised
+ * kernels (i.e., fewer than a single vector).
+ *
+ * Each character is transformed by a single table lookup, and the key position
+ * advanced by alpha_table - isalpha(), isupper(), toupper() and '%' are thereby 
+ * removed from the loop, alongside any branches upon the character itself.
+ *
+ * As with every kernel, the characters of input are written to output, which may
+ * be the same buffer (in place), or another of (at least) the same length.
+ */
+static void
+transform_scalar(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  const unsigned char (*tables)[256] = shift_tables[key_operation(key_state, mode)], *shifts = key_state->shifts;
+  const size_t key_len = key_state->key_len;
+  size_t key_pos = key_state->key_pos;
+
+  for (size_t text_ctr = 0; text_ctr < text_len; text_ctr++) {
+    const unsigned char character = (unsigned char)input[text_ctr];
+
+    output[text_ctr] = (char)tables[shifts[key_pos]][character];
+
+    // The comparison is compiled to a conditional move, as opposed to a branch.
+    key_pos += alpha_table[character];
+    key_pos = key_pos == key_len ? 0 : key_pos;
+  }
+
+  key_state->key_pos = key_pos;
+}
+
+/**
+ * Returns an all-ones mask should value be less than limit (both below 2^31), otherwise 0.
+ *
+ * This is taken from the borrow (sign) of the subtraction, as opposed to a comparison, which 
+ * the compiler is free to branch upon - the constant-time kernels are thereby composed of
+ * mask arithmetic alone (see transform_constant()).
+ */
+static inline unsigned int
+less_mask(unsigned int value, unsigned int limit) {
+  return 0U - ((value - limit) >> 31);
+}
+
+// Returns an all-ones mask should the character be alphabetic (A-Z, a-z), otherwise 0.
+static inline unsigned int
+alpha_mask(unsigned int character) {
+  return less_mask(((character | 0x20) - ASCII_LOWER_OFFSET) & 0xFF, CHAR_SPACE);
+}
+
+/**
+ * Counts the alphabetic characters within text (that is, the number of key
+ * positions the text would advance the key by), without transforming it.
+ *
+ * This allows the starting key position of any chunk to be determined prior to
+ * transforming the preceding chunks (see vigenere_transform_parallel()).
+ *
+ * The characters are classified by alpha_mask() rather than alpha_table, whereby the 
+ * count is independent of the cache (as every kernel counts the remaining bytes this way).
+ */
+static size_t
+count_scalar(const char *text, size_t text_len) {
+  size_t count = 0;
+
+  for (size_t text_ctr = 0; text_ctr < text_len; text_ctr++)
+    count += alpha_mask((unsigned char)text[text_ctr]) & 1;
+
+  return count;
+}
+
+// Wraps a letter (0-51) into the alphabet (0-25), by subtracting 26 from those exceeding 25.
+static inline unsigned int
+wrap_letter(unsigned int letter) {
+  return letter - (CHAR_SPACE & ~less_mask(letter, CHAR_SPACE));
+}
+
+/**
+ * This function is the constant-time scalar kernel ("--constant-time"), which performs
+ * the calculation of the vectorised kernels (see transform_vector_sse41()) one character
+ * at a time, using masks - there are neither branches upon the characters, nor lookup
+ * tables indexed by them, hence the time taken (and the cache lines touched) does not
+ * reveal which characters are letters, nor their case.
+ *
+ * The shift of each letter is still loaded from the key position, which advances with
+ * the letters - should the key span more than a single cache line, the position (that
+ * is, the number of letters transformed so far) is thereby observable at the granularity
+ * of a cache line. The individual characters remain hidden.
+ */
+static void
+transform_constant(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  const operations_t operation = key_operation(key_state, mode);
+  const unsigned char *shifts = key_state->shifts;
+  const size_t key_len = key_state->key_len;
+  size_t key_pos = key_state->key_pos;
+
+  // The operation depends upon the cipher alone, hence is selected by masks, once.
+  const unsigned int reflect = 0U - (unsigned int)(operation == Reflect),
+                     subtract = 0U - (unsigned int)(operation == Subtract);
+
+  for (size_t text_ctr = 0; text_ctr < text_len; text_ctr++) {
+    const unsigned int character = (unsigned char)input[text_ctr], alpha = alpha_mask(character);
+
+    // Non-alphabetic characters yield letter 0, so that the arithmetic below remains within range.
+    unsigned int letter = ((character | 0x20) - ASCII_LOWER_OFFSET) & alpha, shift = shifts[key_pos];
+
+    letter ^= (letter ^ wrap_letter(CHAR_SPACE - letter)) & reflect;
+    shift ^= (shift ^ (CHAR_SPACE - shift)) & subtract;
+
+    const unsigned int result = wrap_letter(letter + shift) + (ASCII_HIGHER_OFFSET | (character & 0x20));
+    output[text_ctr] = (char)(character ^ ((character ^ result) & alpha));
+
+    // The key position is wrapped by masking it to 0 once it reaches key_len (key_pos ^ key_len == 0).
+    key_pos += alpha & 1;
+
+    const size_t remaining = key_pos ^ key_len;
+    key_pos &= 0 - ((remaining | (0 - remaining)) >> (sizeof(size_t) * 8 - 1));
+  }
+
+  key_state->key_pos = key_pos;
+}
+
+/**
+ * Returns the length of the leading run of text consisting of whole 32-byte blocks of ASCII
+ * (that is, bytes without the high bit set), which the UTF-8 validation skips.
+ *
+ * Each block is tested as four 64-bit words OR'd together (SWAR), rather than byte by byte.
+ */
+static size_t
+ascii_scalar(const char *text, size_t text_len) {
+  size_t text_ctr = 0;
+
+  for (; text_ctr + 32 <= text_len; text_ctr += 32) {
+    uint64_t words[4];
+
+    memcpy(words, text + text_ctr, sizeof(words));
+    if ((words[0] | words[1] | words[2] | words[3]) & 0x8080808080808080ULL) break;
+  }
+
+  return text_ctr;
+}
+
+/**
+ * Returns the length of the ring of shifts walked by the vectorised kernels, that is, the
+ * smallest multiple of key_len spanning at least KEY_RING_WIDTH shifts. A vector advances the
+ * key by at most KEY_RING_WIDTH, hence the position within the ring always wraps with a single
+ * subtraction (see advance_key_pos()) - whereas wrapping a key shorter than a vector at key_len
+ * would otherwise require a modulo per vector.
+ *
+ * The ring is at most key_len + KEY_RING_WIDTH - 1 shifts, and each vector of shifts is loaded
+ * from at most KEY_RING_WIDTH - 1 shifts beyond its position - both of which lie within the
+ * KEY_RING_PADDING repeats following the key, as these are contiguous.
+ */
+static inline size_t
+key_ring_len(size_t key_len) {
+  return key_len >= KEY_RING_WIDTH ? key_len : key_len * ((KEY_RING_WIDTH + key_len - 1) / key_len);
+}
+
+/**
+ * Advances the position within the ring (see key_ring_len()) by the number of alphabetic
+ * characters (count) within a vector.
+ */
+static inline size_t
+advance_key_pos(size_t key_pos, size_t count, size_t ring_len) {
+  key_pos += count;
+  return key_pos >= ring_len ? key_pos - ring_len : key_pos;
+}
+
+// Returns the key position of a position within the ring, once the vectors have been transformed.
+static inline size_t
+ring_key_pos(size_t key_pos, size_t key_len) {
+  return key_pos < key_len ? key_pos : key_pos % key_len;
+}
+
+/**
+ * Whilst gathering a histogram (see transform_counted()), each character is recorded as
+ * the pair of its letter and that of the character it is transformed into, where
+ * pair = input letter + (output letter << PAIR_SHIFT), and PAIR_NONE stands for any
+ * character besides a letter. A single tally of the pairs thereby yields both histograms,
+ * whereby each character costs one increment, rather than one upon either side.
+ */
+#define PAIR_NONE CHAR_SPACE
+#define PAIR_SHIFT 5
+#define PAIR_SPACE ((CHAR_SPACE + 1) << PAIR_SHIFT)
+
+// Returns the letter (0-25) of a character of either case, or PAIR_NONE should it not be alphabetic.
+static inline unsigned int
+pair_letter(unsigned char character) {
+  const unsigned int letter = ((unsigned int)(character | 0x20) - ASCII_LOWER_OFFSET) & 0xFF;
+  return letter < CHAR_SPACE ? letter : PAIR_NONE;
+}
+
+/**
+ * Transforms input into output using transform(), whilst recording the pair of each
+ * character within pairs. The input letters are recorded prior to transforming, as output
+ * may be the same buffer. This pairs the kernels without vectors of their own (see
+ * kernel_t.pair), alongside the remaining bytes of those with them.
+ */
+static void
+pair_scalar(void (*transform)(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode),
+            const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode, uint16_t *pairs) {
+  for (size_t text_ctr = 0; text_ctr < text_len; text_ctr++)
+    pairs[text_ctr] = (uint16_t)pair_letter((unsigned char)input[text_ctr]);
+
+  transform(input, output, text_len, key_state, mode);
+
+  for (size_t text_ctr = 0; text_ctr < text_len; text_ctr++)
+    pairs[text_ctr] |= (uint16_t)(pair_letter((unsigned char)output[text_ctr]) << PAIR_SHIFT);
+}
+
+#ifdef VIGENERE_X86_SIMD
+
+/**
+ * Transforms 16 characters at once (SSE4.1).
+ *
+ * In essence, this performs the same calculation as encrypt()/decrypt(), but
+ * without branches, division nor ctype.h:
+ *
+ * 1. Each character is classified as alphabetic by converting it to lowercase
+ *    (OR 0x20) and checking that c - 'a' is within 0-25 (unsigned comparison).
+ * 2. As only alphabetic characters advance the key, the shift for character i is
+ *    K[key_pos + (alphabetic characters prior to i)]. This count is computed
+ *    via a prefix sum, and the shifts are then gathered using a byte shuffle.
+ * 3. The shift is added (to subtract, 26 - K[i] is added), and wrapped modulo
+ *    26 by subtracting 26 where the result exceeds 25 - min(r, r - 26) does this,
+ *    as r - 26 wraps around to a large (unsigned) value when r < 26. To reflect
+ *    (K - M), the letter is first negated (26 - M, wrapped in the same manner).
+ * 4. 'A' is added, the case bit (0x20) of the original character is restored, and
+ *    non-alphabetic characters are blended back in unchanged.
+ */
+__attribute__((target("sse4.1")))
+static inline __m128i
+transform_vector_sse41(__m128i text, __m128i alpha, __m128i shifts, operations_t operation) {
+  __m128i index = _mm_sub_epi8(_mm_or_si128(text, _mm_set1_epi8(0x20)), _mm_set1_epi8(ASCII_LOWER_OFFSET));
+  const __m128i ones = _mm_and_si128(alpha, _mm_set1_epi8(1));
+
+  if (operation == Reflect) {
+    index = _mm_sub_epi8(_mm_set1_epi8(CHAR_SPACE), index);
+    index = _mm_min_epu8(index, _mm_sub_epi8(index, _mm_set1_epi8(CHAR_SPACE)));
+  }
+
+  // Inclusive prefix sum of the alphabetic characters, less the character itself.
+  __m128i prefix = _mm_add_epi8(ones, _mm_slli_si128(ones, 1));
+  prefix = _mm_add_epi8(prefix, _mm_slli_si128(prefix, 2));
+  prefix = _mm_add_epi8(prefix, _mm_slli_si128(prefix, 4));
+  prefix = _mm_add_epi8(prefix, _mm_slli_si128(prefix, 8));
+  prefix = _mm_sub_epi8(prefix, ones);
+
+  __m128i shift = _mm_shuffle_epi8(shifts, prefix);
+  if (operation == Subtract) shift = _mm_sub_epi8(_mm_set1_epi8(CHAR_SPACE), shift);
+
+  __m128i result = _mm_add_epi8(index, shift);
+  result = _mm_min_epu8(result, _mm_sub_epi8(result, _mm_set1_epi8(CHAR_SPACE)));
+  result = _mm_add_epi8(result, _mm_or_si128(_mm_set1_epi8(ASCII_HIGHER_OFFSET), 
+                                             _mm_and_si128(text, _mm_set1_epi8(0x20))));
+
+  return _mm_blendv_epi8(text, result, alpha);
+}
+
+// Classifies 16 characters, yielding 0xFF for alphabetic characters (A-Z, a-z) and 0 otherwise.
+__attribute__((target("sse4.1")))
+static inline __m128i
+classify_vector_sse41(__m128i text) {
+  const __m128i index = _mm_sub_epi8(_mm_or_si128(text, _mm_set1_epi8(0x20)), _mm_set1_epi8(ASCII_LOWER_OFFSET));
+  return _mm_cmpeq_epi8(_mm_min_epu8(index, _mm_set1_epi8(CHAR_SPACE - 1)), index);
+}
+
+/**
+ * Records the pairs (see PAIR_SHIFT) of 16 characters, from their letters (input) and
+ * those they were transformed into (output), each 0-25 or PAIR_NONE. Interleaving either
+ * byte with its counterpart forms a pair within each 16-bit lane, which is then weighed
+ * (the input letter by 1, and the output letter by 2^PAIR_SHIFT) and summed by maddubs.
+ *
+ * The pairs are written in the order of the unpacks rather than that of the characters,
+ * as only their tally is of interest.
+ */
+__attribute__((target("sse4.1")))
+static inline void
+pair_vector_sse41(__m128i input, __m128i output, uint16_t *pairs) {
+  const __m128i weights = _mm_set1_epi16(1 | (1 << PAIR_SHIFT) << 8);
+
+  _mm_storeu_si128((__m128i *)pairs, _mm_maddubs_epi16(_mm_unpacklo_epi8(input, output), weights));
+  _mm_storeu_si128((__m128i *)(pairs + 8), _mm_maddubs_epi16(_mm_unpackhi_epi8(input, output), weights));
+}
+
+// Returns the letters (0-25) of 16 characters of either case, or PAIR_NONE for those besides letters.
+__attribute__((target("sse4.1")))
+static inline __m128i
+pair_letters_sse41(__m128i text) {
+  const __m128i index = _mm_sub_epi8(_mm_or_si128(text, _mm_set1_epi8(0x20)), _mm_set1_epi8(ASCII_LOWER_OFFSET));
+  return _mm_min_epu8(index, _mm_set1_epi8(PAIR_NONE));
+}
+
+/**
+ * constant_time is non-zero for the constant-time kernel ("sse4.1-ct"), which transforms
+ * every block - including those without letters, which are otherwise copied as they are -
+ * and transforms the remaining bytes using transform_constant(). As this is forcibly
+ * inlined with a constant, either kernel is specialised as though written separately.
+ *
+ * Similarly, pairs is NULL unless gathering a histogram (see kernel_t.pair), whereupon the
+ * pair of each character is recorded within it.
+ */
+__attribute__((target("sse4.1")))
+static ALWAYS_INLINE void
+transform_blocks_sse41(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode,
+                       const int constant_time, uint16_t *pairs) {
+  const operations_t operation = key_operation(key_state, mode);
+  const size_t ring_len = key_ring_len(key_state->key_len);
+  size_t key_pos = key_state->key_pos, text_ctr = 0;
+
+  for (; text_ctr + 16 <= text_len; text_ctr += 16) {
+    const __m128i block = _mm_loadu_si128((const __m128i *)(input + text_ctr));
+    const __m128i alpha = classify_vector_sse41(block);
+    const int mask = _mm_movemask_epi8(alpha);
+
+    // Blocks without any alphabetic characters (i.e., numbers, whitespace) are copied as they are.
+    if (!constant_time && mask == 0) {
+      _mm_storeu_si128((__m128i *)(output + text_ctr), block);
+      if (pairs != NULL) pair_vector_sse41(_mm_set1_epi8(PAIR_NONE), _mm_set1_epi8(PAIR_NONE), pairs + text_ctr);
+      continue;
+    }
+
+    const __m128i shifts = _mm_loadu_si128((const __m128i *)(key_state->shifts + key_pos)),
+                  result = transform_vector_sse41(block, alpha, shifts, operation);
+
+    _mm_storeu_si128((__m128i *)(output + text_ctr), result);
+    if (pairs != NULL) pair_vector_sse41(pair_letters_sse41(block), pair_letters_sse41(result), pairs + text_ctr);
+    key_pos = advance_key_pos(key_pos, __builtin_popcount(mask), ring_len);
+  }
+
+  key_state->key_pos = ring_key_pos(key_pos, key_state->key_len);
+
+  if (pairs != NULL) pair_scalar(transform_scalar, input + text_ctr, output + text_ctr, text_len - text_ctr,
+                                 key_state, mode, pairs + text_ctr);
+  else if (constant_time) transform_constant(input + text_ctr, output + text_ctr, text_len - text_ctr, key_state, mode);
+  else transform_scalar(input + text_ctr, output + text_ctr, text_len - text_ctr, key_state, mode);
+}
+
+__attribute__((target("sse4.1")))
+static void
+transform_sse41(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_blocks_sse41(input, output, text_len, key_state, mode, 0, NULL);
+}
+
+__attribute__((target("sse4.1")))
+static void
+transform_sse41_ct(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_blocks_sse41(input, output, text_len, key_state, mode, 1, NULL);
+}
+
+__attribute__((target("sse4.1")))
+static void
+pair_sse41(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode, uint16_t *pairs) {
+  transform_blocks_sse41(input, output, text_len, key_state, mode, 0, pairs);
+}
+
+// Counts the alphabetic characters within text, 16 at a time (SSE4.1).
+__attribute__((target("sse4.1")))
+static size_t
+count_sse41(const char *text, size_t text_len) {
+  size_t count = 0, text_ctr = 0;
+
+  for (; text_ctr + 16 <= text_len; text_ctr += 16)
+    count += __builtin_popcount(_mm_movemask_epi8(
+      classify_vector_sse41(_mm_loadu_si128((const __m128i *)(text + text_ctr)))));
+
+  return count + count_scalar(text + text_ctr, text_len - text_ctr);
+}
+
+// Returns the length of the leading ASCII blocks of text (see ascii_scalar()), 16 bytes at a time (SSE4.1).
+__attribute__((target("sse4.1")))
+static size_t
+ascii_sse41(const char *text, size_t text_len) {
+  size_t text_ctr = 0;
+
+  for (; text_ctr + 32 <= text_len; text_ctr += 32) {
+    const __m128i block = _mm_or_si128(_mm_loadu_si128((const __m128i *)(text + text_ctr)), 
+                                       _mm_loadu_si128((const __m128i *)(text + text_ctr + 16)));
+    if (_mm_movemask_epi8(block) != 0) break;
+  }
+
+  return text_ctr;
+}
+
+// Records the pairs of 32 characters (see pair_vector_sse41(), whereby the unpacks are within each 128-bit lane).
+__attribute__((target("avx2")))
+static inline void
+pair_vector_avx2(__m256i input, __m256i output, uint16_t *pairs) {
+  const __m256i weights = _mm256_set1_epi16(1 | (1 << PAIR_SHIFT) << 8);
+
+  _mm256_storeu_si256((__m256i *)pairs, _mm256_maddubs_epi16(_mm256_unpacklo_epi8(input, output), weights));
+  _mm256_storeu_si256((__m256i *)(pairs + 16), _mm256_maddubs_epi16(_mm256_unpackhi_epi8(input, output), weights));
+}
+
+/**
+ * Transforms 32 characters at once (AVX2).
+ *
+ * As the AVX2 shuffle operates within each 128-bit lane, the lanes are treated as
+ * two SSE vectors: the upper lane's shifts are simply loaded from the key position
+ * following the alphabetic characters of the lower lane.
+ *
+ * constant_time is non-zero for the constant-time kernel ("avx2-ct"), and pairs is NULL unless
+ * gathering a histogram (see transform_blocks_sse41()) - the pairs are taken from the letters
+ * the transformation has already found (index and result), prior to restoring their case.
+ */
+__attribute__((target("avx2")))
+static ALWAYS_INLINE void
+transform_blocks_avx2(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode,
+                      const int constant_time, uint16_t *pairs) {
+  const __m256i lower_bit = _mm256_set1_epi8(0x20), alphabet = _mm256_set1_epi8(CHAR_SPACE),
+                lower_offset = _mm256_set1_epi8(ASCII_LOWER_OFFSET), one = _mm256_set1_epi8(1);
+  const operations_t operation = key_operation(key_state, mode);
+  const size_t ring_len = key_ring_len(key_state->key_len);
+  size_t key_pos = key_state->key_pos, text_ctr = 0;
+
+  for (; text_ctr + 32 <= text_len; text_ctr += 32) {
+    const __m256i block = _mm256_loadu_si256((const __m256i *)(input + text_ctr));
+    __m256i index = _mm256_sub_epi8(_mm256_or_si256(block, lower_bit), lower_offset);
+    const __m256i alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(index, _mm256_set1_epi8(CHAR_SPACE - 1)), index);
+    const unsigned int mask = (unsigned int)_mm256_movemask_epi8(alpha);
+
+    if (!constant_time && mask == 0) {
+      _mm256_storeu_si256((__m256i *)(output + text_ctr), block);
+      if (pairs != NULL) pair_vector_avx2(_mm256_set1_epi8(PAIR_NONE), _mm256_set1_epi8(PAIR_NONE), pairs + text_ctr);
+      continue;
+    }
+
+    const int lower_count = __builtin_popcount(mask & 0xFFFF);
+    const __m128i lower_shifts = _mm_loadu_si128((const __m128i *)(key_state->shifts + key_pos)),
+                  upper_shifts = _mm_loadu_si128((const __m128i *)(key_state->shifts + key_pos + lower_count));
+    const __m256i shifts = _mm256_inserti128_si256(_mm256_castsi128_si256(lower_shifts), upper_shifts, 1);
+
+    // Prefix sum within each lane (see transform_vector_sse41()).
+    const __m256i ones = _mm256_and_si256(alpha, one);
+    __m256i prefix = _mm256_add_epi8(ones, _mm256_slli_si256(ones, 1));
+    prefix = _mm256_add_epi8(prefix, _mm256_slli_si256(prefix, 2));
+    prefix = _mm256_add_epi8(prefix, _mm256_slli_si256(prefix, 4));
+    prefix = _mm256_add_epi8(prefix, _mm256_slli_si256(prefix, 8));
+    prefix = _mm256_sub_epi8(prefix, ones);
+
+    __m256i shift = _mm256_shuffle_epi8(shifts, prefix);
+    if (operation == Subtract) shift = _mm256_sub_epi8(alphabet, shift);
+
+    const __m256i input_letters = _mm256_min_epu8(index, alphabet); // 0-25, or PAIR_NONE (CHAR_SPACE).
+
+    // The letter is negated once classified (see transform_vector_sse41()).
+    if (operation == Reflect) {
+      index = _mm256_sub_epi8(alphabet, index);
+      index = _mm256_min_epu8(index, _mm256_sub_epi8(index, alphabet));
+    }
+
+    __m256i result = _mm256_add_epi8(index, shift);
+    result = _mm256_min_epu8(result, _mm256_sub_epi8(result, alphabet));
+    if (pairs != NULL) pair_vector_avx2(input_letters, _mm256_blendv_epi8(alphabet, result, alpha), pairs + text_ctr);
+    result = _mm256_add_epi8(result, _mm256_or_si256(_mm256_set1_epi8(ASCII_HIGHER_OFFSET),
+                                                     _mm256_and_si256(block, lower_bit)));
+
+    _mm256_storeu_si256((__m256i *)(output + text_ctr), _mm256_blendv_epi8(block, result, alpha));
+    key_pos = advance_key_pos(key_pos, __builtin_popcount(mask), ring_len);
+  }
+
+  key_state->key_pos = ring_key_pos(key_pos, key_state->key_len);
+
+  if (pairs != NULL) pair_sse41(input + text_ctr, output + text_ctr, text_len - text_ctr, key_state, mode, pairs + text_ctr);
+  else if (constant_time) transform_sse41_ct(input + text_ctr, output + text_ctr, text_len - text_ctr, key_state, mode);
+  else transform_sse41(input + text_ctr, output + text_ctr, text_len - text_ctr, key_state, mode);
+}
+
+__attribute__((target("avx2")))
+static void
+transform_avx2(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_blocks_avx2(input, output, text_len, key_state, mode, 0, NULL);
+}
+
+__attribute__((target("avx2")))
+static void
+transform_avx2_ct(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_blocks_avx2(input, output, text_len, key_state, mode, 1, NULL);
+}
+
+__attribute__((target("avx2")))
+static void
+pair_avx2(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode, uint16_t *pairs) {
+  transform_blocks_avx2(input, output, text_len, key_state, mode, 0, pairs);
+}
+
+// Counts the alphabetic characters within text, 32 at a time (AVX2).
+__attribute__((target("avx2")))
+static size_t
+count_avx2(const char *text, size_t text_len) {
+  const __m256i lower_bit = _mm256_set1_epi8(0x20), lower_offset = _mm256_set1_epi8(ASCII_LOWER_OFFSET),
+                last_letter = _mm256_set1_epi8(CHAR_SPACE - 1);
+  size_t count = 0, text_ctr = 0;
+
+  for (; text_ctr + 32 <= text_len; text_ctr += 32) {
+    const __m256i block = _mm256_loadu_si256((const __m256i *)(text + text_ctr));
+    const __m256i index = _mm256_sub_epi8(_mm256_or_si256(block, lower_bit), lower_offset);
+    count += __builtin_popcount((unsigned int)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_min_epu8(index, last_letter), index)));
+  }
+
+  return count + count_sse41(text + text_ctr, text_len - text_ctr);
+}
+
+// Returns the length of the leading ASCII blocks of text (see ascii_scalar()), 32 bytes at a time (AVX2).
+__attribute__((target("avx2")))
+static size_t
+ascii_avx2(const char *text, size_t text_len) {
+  size_t text_ctr = 0;
+
+  for (; text_ctr + 32 <= text_len; text_ctr += 32)
+    if (_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(text + text_ctr))) != 0) break;
+
+  return text_ctr;
+}
+
+#endif
+
+#ifdef VIGENERE_NEON
+
+// Records the pairs of 16 characters (see pair_vector_sse41()), by widening either half of the output letters.
+static inline void
+pair_vector_neon(uint8x16_t input, uint8x16_t output, uint16_t *pairs) {
+  vst1q_u16(pairs, vaddw_u8(vshll_n_u8(vget_low_u8(output), PAIR_SHIFT), vget_low_u8(input)));
+  vst1q_u16(pairs + 8, vaddw_u8(vshll_n_u8(vget_high_u8(output), PAIR_SHIFT), vget_high_u8(input)));
+}
+
+/**
+ * Transforms 16 characters at once (NEON).
+ *
+ * This follows the same approach as transform_vector_sse41(), whereby vextq_u8()
+ * shifts the vector for the prefix sum, and vqtbl1q_u8() gathers the shifts.
+ *
+ * constant_time is non-zero for the constant-time kernel ("neon-ct"), and pairs is NULL unless
+ * gathering a histogram (see transform_blocks_sse41() and transform_blocks_avx2()).
+ */
+static ALWAYS_INLINE void
+transform_blocks_neon(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode,
+                      const int constant_time, uint16_t *pairs) {
+  const uint8x16_t zero = vdupq_n_u8(0), lower_bit = vdupq_n_u8(0x20), alphabet = vdupq_n_u8(CHAR_SPACE);
+  const operations_t operation = key_operation(key_state, mode);
+  const size_t ring_len = key_ring_len(key_state->key_len);
+  size_t key_pos = key_state->key_pos, text_ctr = 0;
+
+  for (; text_ctr + 16 <= text_len; text_ctr += 16) {
+    const uint8x16_t block = vld1q_u8((const uint8_t *)(input + text_ctr));
+    uint8x16_t index = vsubq_u8(vorrq_u8(block, lower_bit), vdupq_n_u8(ASCII_LOWER_OFFSET));
+    const uint8x16_t alpha = vcleq_u8(index, vdupq_n_u8(CHAR_SPACE - 1));
+    const uint8x16_t ones = vandq_u8(alpha, vdupq_n_u8(1));
+    const unsigned int count = vaddvq_u8(ones);
+
+    if (!constant_time && count == 0) {
+      vst1q_u8((uint8_t *)(output + text_ctr), block);
+      if (pairs != NULL) pair_vector_neon(alphabet, alphabet, pairs + text_ctr);
+      continue;
+    }
+
+    uint8x16_t prefix = vaddq_u8(ones, vextq_u8(zero, ones, 15));
+    prefix = vaddq_u8(prefix, vextq_u8(zero, prefix, 14));
+    prefix = vaddq_u8(prefix, vextq_u8(zero, prefix, 12));
+    prefix = vaddq_u8(prefix, vextq_u8(zero, prefix, 8));
+    prefix = vsubq_u8(prefix, ones);
+
+    uint8x16_t shift = vqtbl1q_u8(vld1q_u8(key_state->shifts + key_pos), prefix);
+    if (operation == Subtract) shift = vsubq_u8(alphabet, shift);
+
+    const uint8x16_t input_letters = vminq_u8(index, alphabet); // 0-25, or PAIR_NONE (CHAR_SPACE).
+    if (operation == Reflect) {
+      index = vsubq_u8(alphabet, index);
+      index = vminq_u8(index, vsubq_u8(index, alphabet));
+    }
+
+    uint8x16_t result = vaddq_u8(index, shift);
+    result = vminq_u8(result, vsubq_u8(result, alphabet));
+    if (pairs != NULL) pair_vector_neon(input_letters, vbslq_u8(alpha, result, alphabet), pairs + text_ctr);
+    result = vaddq_u8(result, vorrq_u8(vdupq_n_u8(ASCII_HIGHER_OFFSET), vandq_u8(block, lower_bit)));
+
+    vst1q_u8((uint8_t *)(output + text_ctr), vbslq_u8(alpha, result, block));
+    key_pos = advance_key_pos(key_pos, count, ring_len);
+  }
+
+  key_state->key_pos = ring_key_pos(key_pos, key_state->key_len);
+
+  if (pairs != NULL) pair_scalar(transform_scalar, input + text_ctr, output + text_ctr, text_len - text_ctr,
+                                 key_state, mode, pairs + text_ctr);
+  else if (constant_time) transform_constant(input + text_ctr, output + text_ctr, text_len - text_ctr, key_state, mode);
+  else transform_scalar(input + text_ctr, output + text_ctr, text_len - text_ctr, key_state, mode);
+}
+
+static void
+transform_neon(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_blocks_neon(input, output, text_len, key_state, mode, 0, NULL);
+}
+
+static void
+transform_neon_ct(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_blocks_neon(input, output, text_len, key_state, mode, 1, NULL);
+}
+
+static void
+pair_neon(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode, uint16_t *pairs) {
+  transform_blocks_neon(input, output, text_len, key_state, mode, 0, pairs);
+}
+
+// Counts the alphabetic characters within text, 16 at a time (NEON).
+static size_t
+count_neon(const char *text, size_t text_len) {
+  size_t count = 0, text_ctr = 0;
+
+  for (; text_ctr + 16 <= text_len; text_ctr += 16) {
+    const uint8x16_t block = vld1q_u8((const uint8_t *)(text + text_ctr));
+    const uint8x16_t index = vsubq_u8(vorrq_u8(block, vdupq_n_u8(0x20)), vdupq_n_u8(ASCII_LOWER_OFFSET));
+    count += vaddvq_u8(vandq_u8(vcleq_u8(index, vdupq_n_u8(CHAR_SPACE - 1)), vdupq_n_u8(1)));
+  }
+
+  return count + count_scalar(text + text_ctr, text_len - text_ctr);
+}
+
+// Returns the length of the leading ASCII blocks of text (see ascii_scalar()), 16 bytes at a time (NEON).
+static size_t
+ascii_neon(const char *text, size_t text_len) {
+  size_t text_ctr = 0;
+
+  for (; text_ctr + 32 <= text_len; text_ctr += 32) {
+    const uint8x16_t block = vorrq_u8(vld1q_u8((const uint8_t *)(text + text_ctr)), 
+                                      vld1q_u8((const uint8_t *)(text + text_ctr + 16)));
+    if (vmaxvq_u8(block) & 0x80) break;
+  }
+
+  return text_ctr;
+}
+
+#endif
+
+/**
+ * Stores the functions that constitute each kernel (that is, a transformation, the
+ * corresponding alphabetic character count, the ASCII scan used whilst validating
+ * UTF-8 and the transformation recording pairs whilst gathering a histogram), so that
+ * the kernel can be selected once (at runtime) and subsequently called through a pointer.
+ */
+typedef struct kernel {
+  const char *name; // i.e., "avx2".
+  void (*transform)(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode);
+  size_t (*count)(const char *text, size_t text_len);
+  size_t (*ascii)(const char *text, size_t text_len);
+  // transforms as transform() does, recording the pair of each character (see PAIR_SHIFT), or NULL (see pair_scalar()).
+  void (*pair)(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode, uint16_t *pairs);
+} kernel_t;
+
+/**
+ * The original loop (encrypt()/decrypt()) is retained as the "ctype" kernel. This is
+ * never selected automatically, but serves as the baseline when benchmarking.
+ *
+ * As the original loop only adds or subtracts, reflecting (Beaufort) uses the scalar kernel.
+ */
+static void
+transform_reference(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  const operations_t operation = key_operation(key_state, mode);
+
+  if (operation == Reflect) {
+    transform_scalar(input, output, text_len, key_state, mode);
+    return;
+  }
+
+  if (input != output) memcpy(output, input, text_len);
+
+  if (operation == Add) encrypt(output, text_len, key_state);
+  else decrypt(output, text_len, key_state);
+}
+
+static const kernel_t reference_kernel = { "ctype", transform_reference, count_scalar, ascii_scalar, NULL };
+static const kernel_t scalar_kernel = { "scalar", transform_scalar, count_scalar, ascii_scalar, NULL };
+#if defined(VIGENERE_X86_SIMD)
+static const kernel_t sse41_kernel = { "sse4.1", transform_sse41, count_sse41, ascii_sse41, pair_sse41 };
+static const kernel_t avx2_kernel = { "avx2", transform_avx2, count_avx2, ascii_avx2, pair_avx2 };
+#elif defined(VIGENERE_NEON)
+static const kernel_t neon_kernel = { "neon", transform_neon, count_neon, ascii_neon, pair_neon };
+#endif
+
+/**
+ * The constant-time kernels (see vigenere_use_constant_time()), each of which counts the
+ * letters as its counterpart does - the counts are branch-free (besides the loop itself), 
+ * and the remaining bytes are counted by alpha_mask() rather than a table. As the tally of
+ * a histogram is indexed by the letters, it is never constant-time - these thereby leave
+ * pairing to pair_scalar().
+ */
+static const kernel_t scalar_ct_kernel = { "scalar-ct", transform_constant, count_scalar, ascii_scalar, NULL };
+#if defined(VIGENERE_X86_SIMD)
+static const kernel_t sse41_ct_kernel = { "sse4.1-ct", transform_sse41_ct, count_sse41, ascii_sse41, NULL };
+static const kernel_t avx2_ct_kernel = { "avx2-ct", transform_avx2_ct, count_avx2, ascii_avx2, NULL };
+#elif defined(VIGENERE_NEON)
+static const kernel_t neon_ct_kernel = { "neon-ct", transform_neon_ct, count_neon, ascii_neon, NULL };
+#endif
+
+// Every kernel compiled in, from the slowest to the fastest, followed by the constant-time kernels.
+static const kernel_t *const kernels[] = {
+  &reference_kernel, &scalar_kernel,
+#if defined(VIGENERE_X86_SIMD)
+  &sse41_kernel, &avx2_kernel,
+#elif defined(VIGENERE_NEON)
+  &neon_kernel,
+#endif
+  &scalar_ct_kernel,
+#if defined(VIGENERE_X86_SIMD)
+  &sse41_ct_kernel, &avx2_ct_kernel,
+#elif defined(VIGENERE_NEON)
+  &neon_ct_kernel,
+#endif
+};
+
+// The kernel selected by select_kernel(), or NULL prior to the first transformation.
+static const kernel_t *active_kernel = NULL;
+
+/**
+ * The sizes of the extended alphabets (see alphabet_t), and the first character of the
+ * printable alphabet. alphabet_spaces is indexed by alphabet_t.
+ */
+#define ALPHANUMERIC_SPACE 36
+#define PRINTABLE_SPACE 95
+#define BYTE_SPACE 256
+#define PRINTABLE_OFFSET ' '
+
+static const int alphabet_spaces[] = { CHAR_SPACE, ALPHANUMERIC_SPACE, PRINTABLE_SPACE, BYTE_SPACE };
+
+/**
+ * The extended alphabets are implemented by a single (generic) kernel, transform_symbols(),
+ * whose alphabet is given by its size (space). Each alphabet then has its own kernel, which
+ * calls transform_symbols() with a constant space - as this is forcibly inlined, the compiler
+ * specialises the kernel for each alphabet (akin to a C++ template), whereby the modulus and
+ * the classification below are constant-folded, rather than looked up whilst transforming.
+ */
+// Returns the position of the character within the alphabet, or -1 should it be outside of it.
+static ALWAYS_INLINE int
+symbol_index(unsigned char character, const int space) {
+  if (space == ALPHANUMERIC_SPACE) {
+    const unsigned int letter = (unsigned int)(character | 0x20) - ASCII_LOWER_OFFSET, 
+                       digit = (unsigned int)character - '0';
+
+    return letter < CHAR_SPACE ? (int)letter : digit < 10 ? CHAR_SPACE + (int)digit : -1;
+  }
+
+  if (space == PRINTABLE_SPACE) {
+    const unsigned int index = (unsigned int)character - PRINTABLE_OFFSET;
+    return index < PRINTABLE_SPACE ? (int)index : -1;
+  }
+
+  // Every byte is within the byte alphabet.
+  return character;
+}
+
+// Returns the character at the given position (0 to space - 1) within the alphabet.
+static ALWAYS_INLINE unsigned char
+symbol_character(int index, const int space) {
+  if (space == ALPHANUMERIC_SPACE) 
+    return (unsigned char)(index < CHAR_SPACE ? ASCII_HIGHER_OFFSET + index : '0' + index - CHAR_SPACE);
+  if (space == PRINTABLE_SPACE) return (unsigned char)(PRINTABLE_OFFSET + index);
+
+  return (unsigned char)index;
+}
+
+/**
+ * Combines the position of a character (index) with the shift, as per the operation, within
+ * the alphabet of the given size - as both are below space, a single subtraction wraps this.
+ */
+static ALWAYS_INLINE int
+combine_symbol(int index, int shift, operations_t operation, const int space) {
+  const int result = operation == Add ? index + shift : operation == Subtract ? index + space - shift : 
+                     shift + space - index;
+
+  return result >= space ? result - space : result;
+}
+
+/**
+ * Transforms text within the alphabet of the given size (see above), similarly to
+ * transform_scalar() - the shift is combined with the character (see combine_symbol()),
+ * and wrapped by a single subtraction, as both the index and the shift are below space.
+ *
+ * As every byte belongs to the byte alphabet, the key advances by one per character. Blocks
+ * of 16 bytes are thus transformed using the 16 (contiguous) shifts from the key position,
+ * which the compiler vectorises, with the key position advanced once per block.
+ */
+static ALWAYS_INLINE void
+transform_symbols(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode,
+                  const int space) {
+  const operations_t operation = key_operation(key_state, mode);
+  const unsigned char *shifts = key_state->shifts;
+  const size_t key_len = key_state->key_len;
+  size_t key_pos = key_state->key_pos, text_ctr = 0;
+
+  if (space == BYTE_SPACE) {
+    const size_t ring_len = key_ring_len(key_len);
+
+    for (; text_ctr + 16 <= text_len; text_ctr += 16) {
+      for (size_t byte_ctr = 0; byte_ctr < 16; byte_ctr++) {
+        const unsigned char character = (unsigned char)input[text_ctr + byte_ctr], shift = shifts[key_pos + byte_ctr];
+        output[text_ctr + byte_ctr] = (char)(unsigned char)(operation == Add ? character + shift : 
+                                                            operation == Subtract ? character - shift : shift - character);
+      }
+
+      key_pos = advance_key_pos(key_pos, 16, ring_len);
+    }
+
+    key_pos = ring_key_pos(key_pos, key_len);
+  }
+
+  for (; text_ctr < text_len; text_ctr++) {
+    const int index = symbol_index((unsigned char)input[text_ctr], space);
+
+    if (index < 0) {
+      output[text_ctr] = input[text_ctr];
+      continue;
+    }
+
+    output[text_ctr] = (char)symbol_character(combine_symbol(index, shifts[key_pos], operation, space), space);
+    key_pos = key_pos + 1 == key_len ? 0 : key_pos + 1;
+  }
+
+  key_state->key_pos = key_pos;
+}
+
+// Counts the characters of text within the alphabet of the given size.
+static ALWAYS_INLINE size_t
+count_symbols(const char *text, size_t text_len, const int space) {
+  size_t count = 0;
+
+  if (space == BYTE_SPACE) return text_len;
+
+  for (size_t text_ctr = 0; text_ctr < text_len; text_ctr++)
+    count += symbol_index((unsigned char)text[text_ctr], space) >= 0;
+
+  return count;
+}
+
+// The specialised kernels of each extended alphabet.
+static void
+transform_alphanumeric(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_symbols(input, output, text_len, key_state, mode, ALPHANUMERIC_SPACE);
+}
+
+static size_t
+count_alphanumeric(const char *text, size_t text_len) {
+  return count_symbols(text, text_len, ALPHANUMERIC_SPACE);
+}
+
+static void
+transform_printable(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_symbols(input, output, text_len, key_state, mode, PRINTABLE_SPACE);
+}
+
+static size_t
+count_printable(const char *text, size_t text_len) {
+  return count_symbols(text, text_len, PRINTABLE_SPACE);
+}
+
+static void
+transform_bytes(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  transform_symbols(input, output, text_len, key_state, mode, BYTE_SPACE);
+}
+
+static size_t
+count_bytes(const char *text, size_t text_len) {
+  return count_symbols(text, text_len, BYTE_SPACE);
+}
+
+/**
+ * The kernels of the extended alphabets, indexed by alphabet_t (less one, as Letters uses
+ * the selected kernel). These are never selected by name (see vigenere_use_kernel()), and
+ * the selected kernel's ASCII scan is used regardless of the alphabet.
+ */
+static const kernel_t alphabet_kernels[] = {
+  { "alphanumeric", transform_alphanumeric, count_alphanumeric, NULL, NULL },
+  { "printable", transform_printable, count_printable, NULL, NULL },
+  { "bytes", transform_bytes, count_bytes, NULL, NULL },
+};
+
+/**
+ * This function transforms text using an autokey (see key_state_t), within any alphabet.
+ *
+ * The shift of each character is taken from the ring (key_state->autokey), and then
+ * replaced by that of the plaintext character - for encryption, the character itself, and
+ * for decryption, the character produced. As each shift depends upon the text preceding it
+ * (by key_len characters), autokeys are transformed one character at a time, and never
+ * split between threads.
+ */
+static void
+transform_autokey(const char *input, char *output, size_t text_len, key_state_t *key_state, modes_t mode) {
+  const int space = alphabet_spaces[key_state->alphabet];
+  const operations_t operation = key_operation(key_state, mode);
+  const unsigned char (*tables)[256] = shift_tables[operation];
+  unsigned char *ring = key_state->autokey;
+  const size_t key_len = key_state->key_len;
+  size_t key_pos = key_state->key_pos;
+
+  for (size_t text_ctr = 0; text_ctr < text_len; text_ctr++) {
+    const unsigned char character = (unsigned char)input[text_ctr];
+    int index = 0, plain = 0;
+
+    // Letters preserve their case, hence are transformed using the scalar kernel's tables.
+    if (key_state->alphabet == Letters) {
+      if ((index = (character | 0x20) - ASCII_LOWER_OFFSET) < 0 || index >= CHAR_SPACE) {
+        output[text_ctr] = (char)character;
+        continue;
+      }
+
+      output[text_ctr] = (char)tables[ring[key_pos]][character];
+      plain = mode == Encrypt ? index : (((unsigned char)output[text_ctr] | 0x20) - ASCII_LOWER_OFFSET);
+    } else {
+      if ((index = symbol_index(character, space)) < 0) {
+        output[text_ctr] = (char)character;
+        continue;
+      }
+
+      const int result = combine_symbol(index, ring[key_pos], operation, space);
+
+      output[text_ctr] = (char)symbol_character(result, space);
+      plain = mode == Encrypt ? index : result;
+    }
+
+    ring[key_pos] = (unsigned char)plain;
+    key_pos = key_pos + 1 == key_len ? 0 : key_pos + 1;
+  }
+
+  key_state->key_pos = key_pos;
+}
+
+/**
+ * The autokey kernel, which has no count - as an autokey is never split between threads,
+ * the count is never required.
+ */
+static const kernel_t autokey_kernel = { "autokey", transform_autokey, NULL, NULL, NULL };
+
+/**
+ * This function selects the fastest kernel supported by the processor (and builds
+ * the lookup tables used by the scalar kernel, which every kernel falls back to).
+ *
+ * __builtin_cpu_supports() queries CPUID, hence AVX2 is only used where the
+ * processor (and operating system) supports it, falling back to SSE4.1 and, 
+ * ultimately, the scalar kernel.
+ *
+ * https://gcc.gnu.org/onlinedocs/gcc/x86-Built-in-Functions.html
+ */
+static const kernel_t *
+select_kernel(void) {
+  if (active_kernel != NULL) return active_kernel;
+
+  build_shift_tables();
+  active_kernel = &scalar_kernel;
+
+#if defined(VIGENERE_X86_SIMD)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) active_kernel = &avx2_kernel;
+  else if (__builtin_cpu_supports("sse4.1")) active_kernel = &sse41_kernel;
+#elif defined(VIGENERE_NEON)
+  active_kernel = &neon_kernel;
+#endif
+
+  return active_kernel;
+}
+
+/**
+ * Returns the kernel for the key state, that is, for its alphabet (or should it be an
+ * autokey, the autokey kernel) - the 26-letter alphabet uses the kernel selected by 
+ * select_kernel(), hence is unaffected by the extended alphabets and autokeys.
+ */
+static inline const kernel_t *
+key_state_kernel(const key_state_t *key_state) {
+  // The lookup tables (which autokeys also use) are built upon the kernel being selected.
+  const kernel_t *selected = select_kernel();
+
+  if (key_state->autokey != NULL) return &autokey_kernel;
+  return key_state->alphabet == Letters ? selected : &alphabet_kernels[key_state->alphabet - 1];
+}
+
+// Returns non-zero should the processor support the kernel.
+static int
+kernel_supported(const kernel_t *kernel) {
+#if defined(VIGENERE_X86_SIMD)
+  __builtin_cpu_init();
+  if (kernel == &avx2_kernel || kernel == &avx2_ct_kernel) return __builtin_cpu_supports("avx2");
+  if (kernel == &sse41_kernel || kernel == &sse41_ct_kernel) return __builtin_cpu_supports("sse4.1");
+#endif
+  (void)kernel;
+  return 1;
+}
+
+const char *
+vigenere_kernel(void) {
+  return select_kernel()->name;
+}
+
+const char *
+vigenere_kernel_name(size_t index) {
+  for (size_t kernel_ctr = 0; kernel_ctr < sizeof(kernels) / sizeof(kernels[0]); kernel_ctr++)
+    if (kernel_supported(kernels[kernel_ctr]) && index-- == 0) return kernels[kernel_ctr]->name;
+
+  return NULL;
+}
+
+int
+vigenere_use_kernel(const char *name) {
+  for (size_t kernel_ctr = 0; kernel_ctr < sizeof(kernels) / sizeof(kernels[0]); kernel_ctr++) {
+    if (strncmp(kernels[kernel_ctr]->name, name, strlen(kernels[kernel_ctr]->name) + 1) == 0) {
+      if (!kernel_supported(kernels[kernel_ctr])) return -1;
+
+      // The lookup tables must be built, as with the automatically selected kernel.
+      select_kernel();
+      active_kernel = kernels[kernel_ctr];
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+int
+vigenere_use_constant_time(void) {
+  const kernel_t *kernel = select_kernel();
+
+#if defined(VIGENERE_X86_SIMD)
+  if (kernel == &avx2_kernel || kernel == &avx2_ct_kernel) kernel = &avx2_ct_kernel;
+  else if (kernel == &sse41_kernel || kernel == &sse41_ct_kernel) kernel = &sse41_ct_kernel;
+  else kernel = &scalar_ct_kernel;
+#elif defined(VIGENERE_NEON)
+  kernel = kernel == &neon_kernel || kernel == &neon_ct_kernel ? &neon_ct_kernel : &scalar_ct_kernel;
+#else
+  kernel = &scalar_ct_kernel;
+#endif
+
+  active_kernel = kernel;
+  return 0;
+}
+
+/**
+ * This function is the entry point for transforming a buffer.
+ *
+ * The buffer (buf) of length len is encrypted/decrypted in place, continuing from
+ * key_state->key_pos. The updated key position is returned, so that the caller can
+ * resume from the same point with the next buffer (i.e., chunk or record).
+ *
+ * As the buffer is rewritten in place and the shift table is supplied by the 
+ * caller, no heap allocation is performed - this can be called any number of times
+ * without leaking memory.
+ */
+size_t
+vigenere_transform(char *buf, size_t len, key_state_t *key_state, modes_t mode) {
+
+  // The kernel is selected upon the first call, and reused thereafter.
+  key_state_kernel(key_state)->transform(buf, buf, len, key_state, mode);
+
+  return key_state->key_pos;
+}
+
+/**
+ * Similarly to vigenere_transform(), this function transforms len characters of
+ * input - however, the result is written to output (another buffer of at least len
+ * bytes), leaving input untouched.
+ *
+ * This allows, for example, a read-only mapping of a file to be transformed directly
+ * into a mapping of the output file, without first being copied.
+ */
+size_t
+vigenere_transform_into(const char *input, char *output, size_t len, key_state_t *key_state, modes_t mode) {
+  key_state_kernel(key_state)->transform(input, output, len, key_state, mode);
+
+  return key_state->key_pos;
+}
+
+size_t
+vigenere_count(const char *text, size_t len) {
+  return select_kernel()->count(text, len);
+}
+
+size_t
+vigenere_count_alphabet(const char *text, size_t len, alphabet_t alphabet) {
+  return alphabet == Letters ? vigenere_count(text, len) : alphabet_kernels[alphabet - 1].count(text, len);
+}
+
+/**
+ * The characters of a running key are converted to shifts exactly as those of a key
+ * (see vigenere_fill_shifts_alphabet()), less the characters outside of the alphabet,
+ * which are skipped as they would be within the message.
+ */
+size_t
+vigenere_extract_shifts(const char *text, size_t len, alphabet_t alphabet, unsigned char *shifts,
+                        size_t count, size_t *consumed) {
+  const int space = alphabet_spaces[alphabet];
+  size_t stored = 0, text_ctr = 0;
+
+  for (; text_ctr < len && stored < count; text_ctr++) {
+    const unsigned char character = (unsigned char)text[text_ctr];
+    const int index = alphabet == Letters ? (character | 0x20) - ASCII_LOWER_OFFSET : symbol_index(character, space);
+
+    if (index >= 0 && index < space) shifts[stored++] = (unsigned char)index;
+  }
+
+  *consumed = text_ctr;
+  return stored;
+}
+
+/**
+ * The base letter of each accented Latin letter (U+00C0 - U+017F), or '.' should the
+ * character not be one (i.e., U+00D7, the multiplication sign) or have no single base
+ * letter (i.e., U+00C6, 'Æ').
+ */
+static const char latin_folds[] =
+  "AAAAAA.CEEEEIIIIDNOOOOO.OUUUUY..aaaaaa.ceeeeiiiidnooooo.ouuuuy.y" // U+00C0 - U+00FF
+  "AaAaAaCcCcCcCcDdDdEeEeEeEeEeGgGgGgGgHhHhIiIiIiIiIi..JjKk.LlLlLlL" // U+0100 - U+013F
+  "lLlNnNnNn...OoOoOo..RrRrRrSsSsSsSsTtTtTtUuUuUuUuUuUuWwYyYZzZzZzs"; // U+0140 - U+017F
+
+void
+vigenere_utf8_init(vigenere_utf8_t *utf8) {
+  utf8->offset = 0;
+  utf8->pending = 0;
+  utf8->lower = 0x80;
+  utf8->upper = 0xBF;
+}
+
+/**
+ * Validates a single byte, returning 0 or -1 should it be invalid.
+ *
+ * The lead byte determines the number of continuation bytes (0x80 - 0xBF) to follow. The
+ * range of the first continuation byte is narrowed for the leads which would otherwise
+ * permit overlong forms (0xE0, 0xF0), surrogates (0xED) or code points beyond U+10FFFF (0xF4),
+ * whereas 0xC0, 0xC1 and 0xF5 - 0xFF are never valid.
+ *
+ * https://datatracker.ietf.org/doc/html/rfc3629#section-4
+ */
+static inline int
+utf8_step(vigenere_utf8_t *utf8, unsigned char byte) {
+  if (utf8->pending > 0) {
+    if (byte < utf8->lower || byte > utf8->upper) return -1;
+
+    utf8->lower = 0x80;
+    utf8->upper = 0xBF;
+    utf8->pending--;
+    return 0;
+  }
+
+  if (byte < 0x80) return 0;
+  if (byte < 0xC2 || byte > 0xF4) return -1;
+
+  if (byte < 0xE0) utf8->pending = 1;
+  else if (byte < 0xF0) {
+    utf8->pending = 2;
+    utf8->lower = byte == 0xE0 ? 0xA0 : 0x80;
+    utf8->upper = byte == 0xED ? 0x9F : 0xBF;
+  } else {
+    utf8->pending = 3;
+    utf8->lower = byte == 0xF0 ? 0x90 : 0x80;
+    utf8->upper = byte == 0xF4 ? 0x8F : 0xBF;
+  }
+
+  return 0;
+}
+
+/**
+ * Whole blocks of ASCII are skipped using the kernel's ASCII scan (outside of a character),
+ * following which the block containing the non-ASCII bytes is validated one byte at a time.
+ */
+int
+vigenere_utf8_validate(vigenere_utf8_t *utf8, const char *text, size_t len) {
+  const kernel_t *kernel = select_kernel();
+  size_t text_ctr = 0;
+
+  while (text_ctr < len) {
+    if (utf8->pending == 0) text_ctr += kernel->ascii(text + text_ctr, len - text_ctr);
+
+    const size_t block_end = len - text_ctr < 32 ? len : text_ctr + 32;
+
+    for (; text_ctr < block_end; text_ctr++) {
+      if (utf8_step(utf8, (unsigned char)text[text_ctr]) != 0) {
+        utf8->offset += text_ctr;
+        return -1;
+      }
+    }
+  }
+
+  utf8->offset += len;
+  return 0;
+}
+
+int
+vigenere_utf8_finish(const vigenere_utf8_t *utf8) {
+  return utf8->pending == 0 ? 0 : -1;
+}
+
+size_t
+vigenere_utf8_boundary(const char *text, size_t len) {
+
+  // The last lead byte (if any) is within the final 4 bytes, as no character is longer.
+  for (size_t back = 1; back <= 4 && back <= len; back++) {
+    const unsigned char byte = (unsigned char)text[len - back];
+    if ((byte & 0xC0) == 0x80) continue;
+
+    const size_t char_len = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+    return char_len > back ? len - back : len;
+  }
+
+  return len;
+}
+
+/**
+ * The accented Latin letters are encoded as 0xC3 - 0xC5, followed by a continuation byte.
+ * Blocks of ASCII are skipped (or, once the text has shrunk, moved) using the kernel's 
+ * ASCII scan, as with the validation.
+ */
+size_t
+vigenere_utf8_fold(char *text, size_t len) {
+  const kernel_t *kernel = select_kernel();
+  size_t read = 0, written = 0;
+
+  while (read < len) {
+    const size_t run = kernel->ascii(text + read, len - read);
+
+    if (run > 0 && written != read) memmove(text + written, text + read, run);
+    read += run;
+    written += run;
+
+    const size_t block_end = len - read < 32 ? len : read + 32;
+
+    while (read < block_end) {
+      const unsigned char lead = (unsigned char)text[read];
+
+      if (lead >= 0xC3 && lead <= 0xC5 && read + 1 < len && ((unsigned char)text[read + 1] & 0xC0) == 0x80) {
+        const unsigned int code_point = ((lead & 0x1Fu) << 6) | ((unsigned char)text[read + 1] & 0x3Fu);
+
+        if (latin_folds[code_point - 0xC0] != '.') {
+          text[written++] = latin_folds[code_point - 0xC0];
+          read += 2;
+          continue;
+        }
+      }
+
+      text[written++] = text[read++];
+    }
+  }
+
+  return written;
+}
+
+#ifdef VIGENERE_OPENCL
+/**
+ * Buffers of at least GPU_MIN_SIZE bytes may be transformed upon a GPU (see gpu_transform())
+ * - below this, transferring the buffer to and from the device outweighs transforming it.
+ *
+ * Each buffer is transferred within windows of GPU_WINDOW_SIZE bytes, and each window is
+ * split into spans of GPU_SPAN_SIZE bytes - one work-group per span, whereby each of its
+ * work-items transforms a single byte.
+ */
+#define GPU_MIN_SIZE (64 * 1024 * 1024)
+#define GPU_WINDOW_SIZE (16 * 1024 * 1024)
+#define GPU_SPAN_SIZE 256
+
+// Expands a constant into a string, as it is passed to the programs (see gpu_open()).
+#define GPU_EXPAND(constant) #constant
+#define GPU_STRING(constant) GPU_EXPAND(constant)
+
+/**
+ * The number of windows in flight at once - whilst the device transforms one window, the
+ * next is counted and copied into (and the previous copied out of) the pinned memory
+ * of the other slot (see gpu_slot_t).
+ */
+#define GPU_SLOTS 2
+
+/**
+ * The programs run upon the device, compiled once the device is opened (see gpu_open()).
+ *
+ * transform() is the per-byte transformation. The letters of each span are counted by a 
+ * prefix sum (within the local memory of its work-group), to which the key position at 
+ * the start of the span (offsets, computed by the host) is added - the same two passes as 
+ * vigenere_transform_parallel(), hence the output is identical.
+ *
+ * score() deciphers the sample of a search using a key of key_len letters, and writes the
+ * mean score of its n-grams (see score_key()). Key n is the n-th key of key_len letters 
+ * (A...A to Z...Z), from which its shifts are decoded.
+ */
+static const char gpu_source[] =
+  "__kernel void transform(__global uchar *text, __global const uint *offsets, __global const uchar *shifts,\n"
+  "                        const uint key_len, const uint len, const int operation) {\n"
+  "  __local uint counts[SPAN];\n"
+  "  const uint id = get_global_id(0), local_id = get_local_id(0);\n"
+  "  const uint c = id < len ? text[id] : 0, letter = ((c | 0x20) - 'a') & 0xFF;\n"
+  "\n"
+  "  counts[local_id] = letter < 26;\n"
+  "  barrier(CLK_LOCAL_MEM_FENCE);\n"
+  "  for (uint stride = 1; stride < SPAN; stride <<= 1) {\n"
+  "    const uint preceding = local_id >= stride ? counts[local_id - stride] : 0;\n"
+  "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+  "    counts[local_id] += preceding;\n"
+  "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+  "  }\n"
+  "\n"
+  "  if (id >= len || letter >= 26) return;\n"
+  "\n"
+  "  const uint shift = shifts[(offsets[get_group_id(0)] + counts[local_id] - 1) % key_len];\n"
+  "  const uint shifted = operation == 0 ? letter + shift : operation == 1 ? letter + 26 - shift : shift + 26 - letter;\n"
+  "  text[id] = (uchar)(shifted % 26 + ((c & 0x20) | 'A'));\n"
+  "}\n"
+  "\n"
+  "__kernel void score(__constant uchar *sample, const uint sample_len, __global const float *scores,\n"
+  "                    const uint order, const uint ngram_total, const ulong first_key, const uint key_len,\n"
+  "                    const uint key_count, __global float *results) {\n"
+  "  const uint id = get_global_id(0);\n"
+  "  uchar shifts[MAX_LENGTH];\n"
+  "  ulong number = first_key + id;\n"
+  "  uint index = 0, key_pos = 0;\n"
+  "  float total = 0;\n"
+  "\n"
+  "  if (id >= key_count) return;\n"
+  "  for (uint key_ctr = key_len; key_ctr-- > 0; number /= 26) shifts[key_ctr] = (uchar)(number % 26);\n"
+  "\n"
+  "  for (uint sample_ctr = 0; sample_ctr < sample_len; sample_ctr++) {\n"
+  "    index = (index * 26 + (sample[sample_ctr] + 26 - shifts[key_pos]) % 26) % ngram_total;\n"
+  "    key_pos = key_pos + 1 == key_len ? 0 : key_pos + 1;\n"
+  "    if (sample_ctr + 1 >= order) total += scores[index];\n"
+  "  }\n"
+  "\n"
+  "  results[id] = total / (float)(sample_len - order + 1);\n"
+  "}\n";
+
+/**
+ * This structure holds a slot, that is, the buffers of a window in flight. Each slot has
+ * its own command queue, hence the transfers of one overlap the transformation of the other.
+ *
+ * The host copies each window into (and out of) host_text, which is pinned (page-locked)
+ * memory - the device transfers pinned memory directly, as opposed to staging it through a
+ * pinned buffer of its own. Whilst searching, text instead holds the scores of the keys.
+ */
+typedef struct gpu_slot {
+  cl_command_queue queue;
+  cl_mem text, offsets; // the window (or the scores), and the key position of each span - upon the device.
+  cl_mem pinned_text, pinned_offsets; // the pinned buffers mapped at host_text and host_offsets.
+  unsigned char *host_text;
+  cl_uint *host_offsets;
+  cl_event done; // the completion of the slot's pending window, otherwise NULL.
+  char *output; // the destination of the pending window.
+  size_t len; // the length of the pending window.
+  size_t key_pos; // the key position following the pending window.
+} gpu_slot_t;
+
+/**
+ * This structure holds the device, opened once upon the first use (see gpu_acquire()).
+ *
+ * faster is 0 until the GPU has been compared against the processor (see gpu_transform()), 
+ * then 1 should the GPU be faster, otherwise -1.
+ */
+typedef struct gpu {
+  cl_context context;
+  cl_program program;
+  cl_kernel transform, score;
+  gpu_slot_t slots[GPU_SLOTS];
+  int faster;
+#ifdef VIGENERE_THREADS
+  pthread_mutex_t lock; // held whilst the device is in use.
+#endif
+} gpu_t;
+
+static gpu_t gpu_device;
+static int gpu_opened = 0; // 1 should the device be open, otherwise -1 (once failing to open it).
+
+// Releases each of the objects of the device created thus far.
+static void
+gpu_close(gpu_t *gpu) {
+  for (int slot_ctr = 0; slot_ctr < GPU_SLOTS; slot_ctr++) {
+    gpu_slot_t *slot = &gpu->slots[slot_ctr];
+
+    if (slot->host_text != NULL) clEnqueueUnmapMemObject(slot->queue, slot->pinned_text, slot->host_text, 0, NULL, NULL);
+    if (slot->host_offsets != NULL) clEnqueueUnmapMemObject(slot->queue, slot->pinned_offsets, slot->host_offsets, 0, NULL, NULL);
+    if (slot->queue != NULL) clFinish(slot->queue);
+    if (slot->pinned_offsets != NULL) clReleaseMemObject(slot->pinned_offsets);
+    if (slot->pinned_text != NULL) clReleaseMemObject(slot->pinned_text);
+    if (slot->offsets != NULL) clReleaseMemObject(slot->offsets);
+    if (slot->text != NULL) clReleaseMemObject(slot->text);
+    if (slot->queue != NULL) clReleaseCommandQueue(slot->queue);
+  }
+
+  if (gpu->score != NULL) clReleaseKernel(gpu->score);
+  if (gpu->transform != NULL) clReleaseKernel(gpu->transform);
+  if (gpu->program != NULL) clReleaseProgram(gpu->program);
+  if (gpu->context != NULL) clReleaseContext(gpu->context);
+  memset(gpu, 0, sizeof(gpu_t));
+}
+
+/**
+ * Opens the first GPU of any platform, builds the programs, and allocates the buffers of 
+ * each slot. Should there be no GPU (or should any of these fail), the device is left 
+ * closed, whereby everything is transformed (and searched) upon the processor.
+ *
+ * Only GPUs are considered, as an OpenCL device of the processor would merely compete
+ * with the kernels for the same cores.
+ */
+static void
+gpu_open(void) {
+  gpu_t *gpu = &gpu_device;
+  cl_platform_id platforms[8];
+  cl_device_id device = NULL;
+  cl_uint platform_count = 0;
+  size_t group_size = 0;
+  cl_int error = CL_SUCCESS;
+
+  gpu_opened = -1;
+  if (clGetPlatformIDs(8, platforms, &platform_count) != CL_SUCCESS) return;
+
+  for (cl_uint platform_ctr = 0; platform_ctr < platform_count && device == NULL; platform_ctr++)
+    if (clGetDeviceIDs(platforms[platform_ctr], CL_DEVICE_TYPE_GPU, 1, &device, NULL) != CL_SUCCESS) device = NULL;
+
+  if (device == NULL) return;
+
+  const char *source = gpu_source;
+  const size_t window_spans = GPU_WINDOW_SIZE / GPU_SPAN_SIZE;
+
+  const char *options = "-DSPAN=" GPU_STRING(GPU_SPAN_SIZE) " -DMAX_LENGTH=" GPU_STRING(VIGENERE_MAX_SEARCH_LENGTH);
+
+  int opened = (gpu->context = clCreateContext(NULL, 1, &device, NULL, NULL, &error)) != NULL &&
+               (gpu->program = clCreateProgramWithSource(gpu->context, 1, &source, NULL, &error)) != NULL &&
+               clBuildProgram(gpu->program, 1, &device, options, NULL, NULL) == CL_SUCCESS &&
+               (gpu->transform = clCreateKernel(gpu->program, "transform", &error)) != NULL &&
+               (gpu->score = clCreateKernel(gpu->program, "score", &error)) != NULL &&
+               clGetKernelWorkGroupInfo(gpu->transform, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(group_size), &group_size, NULL) == CL_SUCCESS &&
+               group_size >= GPU_SPAN_SIZE;
+
+  for (int slot_ctr = 0; opened && slot_ctr < GPU_SLOTS; slot_ctr++) {
+    gpu_slot_t *slot = &gpu->slots[slot_ctr];
+
+    opened = (slot->queue = clCreateCommandQueue(gpu->context, device, 0, &error)) != NULL &&
+             (slot->text = clCreateBuffer(gpu->context, CL_MEM_READ_WRITE, GPU_WINDOW_SIZE, NULL, &error)) != NULL &&
+             (slot->offsets = clCreateBuffer(gpu->context, CL_MEM_READ_ONLY, window_spans * sizeof(cl_uint), NULL, &error)) != NULL &&
+             (slot->pinned_text = clCreateBuffer(gpu->context, CL_MEM_ALLOC_HOST_PTR, GPU_WINDOW_SIZE, NULL, &error)) != NULL &&
+             (slot->pinned_offsets = clCreateBuffer(gpu->context, CL_MEM_ALLOC_HOST_PTR, window_spans * sizeof(cl_uint), NULL, &error)) != NULL &&
+             (slot->host_text = (unsigned char *)clEnqueueMapBuffer(slot->queue, slot->pinned_text, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                                                    0, GPU_WINDOW_SIZE, 0, NULL, NULL, &error)) != NULL &&
+             (slot->host_offsets = (cl_uint *)clEnqueueMapBuffer(slot->queue, slot->pinned_offsets, CL_TRUE, CL_MAP_WRITE,
+                                                                 0, window_spans * sizeof(cl_uint), 0, NULL, NULL, &error)) != NULL;
+  }
+
+  if (!opened) {
+    gpu_close(gpu);
+    return;
+  }
+
+#ifdef VIGENERE_THREADS
+  pthread_mutex_init(&gpu->lock, NULL);
+#endif
+  gpu_opened = 1;
+}
+
+/**
+ * Returns the device (opening it upon the first call), which the caller then has sole use
+ * of until gpu_release(). Returns NULL should there be no device, or should another thread
+ * be using it - the caller then simply proceeds upon the processor.
+ */
+static gpu_t *
+gpu_acquire(void) {
+#ifdef VIGENERE_THREADS
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+  pthread_once(&once, gpu_open);
+  if (gpu_opened != 1 || pthread_mutex_trylock(&gpu_device.lock) != 0) return NULL;
+#else
+  if (gpu_opened == 0) gpu_open();
+  if (gpu_opened != 1) return NULL;
+#endif
+
+  return &gpu_device;
+}
+
+static void
+gpu_release(gpu_t *gpu) {
+#ifdef VIGENERE_THREADS
+  pthread_mutex_unlock(&gpu->lock);
+#else
+  (void)gpu;
+#endif
+}
+
+// Returns the current time in seconds (see gpu_transform()).
+static double
+gpu_seconds(void) {
+  struct timespec now;
+
+#ifndef _WIN32
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  timespec_get(&now, TIME_UTC);
+#endif
+
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * Waits for the pending window of the slot, copying it to its destination (should it have
+ * one, as a batch of scores does not). Returns 0 should the device have failed to transform 
+ * it, whereby the destination is left untouched.
+ */
+static int
+gpu_complete(gpu_slot_t *slot) {
+  if (slot->done == NULL) return 1;
+
+  const int completed = clWaitForEvents(1, &slot->done) == CL_SUCCESS;
+
+  clReleaseEvent(slot->done);
+  slot->done = NULL;
+
+  if (completed && slot->output != NULL) memcpy(slot->output, slot->host_text, slot->len);
+  return completed;
+}
+
+// Waits for (and discards) anything enqueued upon the slot, leaving its destination untouched.
+static void
+gpu_discard(gpu_slot_t *slot) {
+  clFinish(slot->queue);
+  if (slot->done != NULL) clReleaseEvent(slot->done);
+  slot->done = NULL;
+}
+
+/**
+ * Submits a window (of at most GPU_WINDOW_SIZE bytes) to the slot, starting at key_pos.
+ *
+ * As with vigenere_transform_parallel(), the letters of each span are counted upon the
+ * host (by the kernel's count), and an exclusive prefix sum of the counts yields the key 
+ * position at the start of each span. Returns 0 should the window fail to be submitted.
+ */
+static int
+gpu_submit(gpu_t *gpu, gpu_slot_t *slot, const char *input, char *output, size_t len, size_t key_pos, 
+           const key_state_t *key_state, const kernel_t *kernel, cl_mem shifts, cl_int operation) {
+  const size_t span_count = (len + GPU_SPAN_SIZE - 1) / GPU_SPAN_SIZE, local_size = GPU_SPAN_SIZE;
+  const size_t global_size = span_count * GPU_SPAN_SIZE;
+  const cl_uint key_len = (cl_uint)key_state->key_len, text_len = (cl_uint)len;
+
+  for (size_t span_ctr = 0; span_ctr < span_count; span_ctr++) {
+    const size_t offset = span_ctr * GPU_SPAN_SIZE, span_len = len - offset < GPU_SPAN_SIZE ? len - offset : GPU_SPAN_SIZE;
+
+    slot->host_offsets[span_ctr] = (cl_uint)key_pos;
+    key_pos = (key_pos + kernel->count(input + offset, span_len)) % key_state->key_len;
+  }
+
+  memcpy(slot->host_text, input, len);
+  slot->output = output;
+  slot->len = len;
+  slot->key_pos = key_pos;
+
+  const int submitted = clEnqueueWriteBuffer(slot->queue, slot->text, CL_FALSE, 0, len, slot->host_text, 0, NULL, NULL) == CL_SUCCESS &&
+                        clEnqueueWriteBuffer(slot->queue, slot->offsets, CL_FALSE, 0, span_count * sizeof(cl_uint), slot->host_offsets, 0, NULL, NULL) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->transform, 0, sizeof(cl_mem), &slot->text) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->transform, 1, sizeof(cl_mem), &slot->offsets) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->transform, 2, sizeof(cl_mem), &shifts) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->transform, 3, sizeof(cl_uint), &key_len) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->transform, 4, sizeof(cl_uint), &text_len) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->transform, 5, sizeof(cl_int), &operation) == CL_SUCCESS &&
+                        clEnqueueNDRangeKernel(slot->queue, gpu->transform, 1, NULL, &global_size, &local_size, 0, NULL, NULL) == CL_SUCCESS &&
+                        clEnqueueReadBuffer(slot->queue, slot->text, CL_FALSE, 0, len, slot->host_text, 0, NULL, &slot->done) == CL_SUCCESS &&
+                        clFlush(slot->queue) == CL_SUCCESS;
+
+  // Anything enqueued before the failure is finished (and discarded), as the slot is then reused.
+  if (!submitted) gpu_discard(slot);
+  return submitted;
+}
+
+// Returns non-zero should the kernel be constant-time, which the GPU (branching upon each letter) is not.
+static int
+kernel_constant_time(const kernel_t *kernel) {
+#if defined(VIGENERE_X86_SIMD)
+  if (kernel == &sse41_ct_kernel || kernel == &avx2_ct_kernel) return 1;
+#elif defined(VIGENERE_NEON)
+  if (kernel == &neon_ct_kernel) return 1;
+#endif
+  return kernel == &scalar_ct_kernel;
+}
+
+/**
+ * This function transforms (a prefix of) input into output upon the GPU, continuing from 
+ * key_state->key_pos, and returns the number of bytes transformed - the caller transforms
+ * the remainder upon the processor. Only the 26-letter alphabet (of a repeating key) is
+ * offloaded.
+ *
+ * The first buffer transformed compares the two: its first window is transformed by the
+ * processor, and its second by the GPU (including the transfers), each being timed. Should
+ * the processor be faster, it transforms everything thereafter - the GPU is therefore only
+ * used should it beat the processor upon this machine.
+ *
+ * Otherwise, the windows are submitted to the slots in turn, so that the transfers of one
+ * overlap the transformation of the other. Should the device fail, the windows completed
+ * thus far are kept, and the rest is left to the processor.
+ */
+static size_t
+gpu_transform(const char *input, char *output, size_t len, key_state_t *key_state, modes_t mode, int threads) {
+  const kernel_t *kernel = key_state_kernel(key_state);
+  size_t done = 0, key_pos = key_state->key_pos;
+  cl_int error = CL_SUCCESS;
+  gpu_t *gpu = NULL;
+
+  if (key_state->autokey != NULL || key_state->alphabet != Letters || kernel_constant_time(kernel) ||
+      key_state->key_len > UINT32_MAX - GPU_SPAN_SIZE || (gpu = gpu_acquire()) == NULL) return 0;
+
+  if (gpu->faster < 0) {
+    gpu_release(gpu);
+    return 0;
+  }
+
+  const cl_int operation = (cl_int)key_operation(key_state, mode);
+  cl_mem shifts = clCreateBuffer(gpu->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, key_state->key_len, 
+                                 (void *)key_state->shifts, &error);
+
+  if (shifts == NULL) {
+    gpu_release(gpu);
+    return 0;
+  }
+
+  if (gpu->faster == 0) {
+    gpu_slot_t *slot = &gpu->slots[0];
+    const double processor_start = gpu_seconds();
+
+    vigenere_transform_parallel(input, output, GPU_WINDOW_SIZE, key_state, mode, threads);
+    done = GPU_WINDOW_SIZE;
+    key_pos = key_state->key_pos;
+
+    const double gpu_start = gpu_seconds();
+
+    if (!gpu_submit(gpu, slot, input + done, output + done, GPU_WINDOW_SIZE, key_pos, key_state, kernel, shifts, operation) ||
+        !gpu_complete(slot)) {
+      gpu->faster = -1;
+    } else {
+      const double gpu_ended = gpu_seconds();
+
+      done += GPU_WINDOW_SIZE;
+      key_pos = slot->key_pos;
+      gpu->faster = gpu_ended - gpu_start < gpu_start - processor_start ? 1 : -1;
+    }
+  }
+
+  size_t submitted = done, submitted_pos = key_pos;
+  int next_slot = 0, failed = 0;
+
+  while (gpu->faster > 0 && submitted < len) {
+    gpu_slot_t *slot = &gpu->slots[next_slot];
+    const size_t window_len = len - submitted < GPU_WINDOW_SIZE ? len - submitted : GPU_WINDOW_SIZE;
+
+    // The slot's previous window is the oldest in flight, hence the windows complete in order.
+    if (slot->done != NULL) {
+      if (!gpu_complete(slot)) {
+        failed = 1;
+        break;
+      }
+
+      done += slot->len;
+      key_pos = slot->key_pos;
+    }
+
+    if (!gpu_submit(gpu, slot, input + submitted, output + submitted, window_len, submitted_pos, key_state, kernel, shifts, operation)) break;
+
+    submitted += window_len;
+    submitted_pos = slot->key_pos;
+    next_slot = (next_slot + 1) % GPU_SLOTS;
+  }
+
+  // The windows still in flight are completed from the oldest - those following a failure are discarded.
+  for (int slot_ctr = 0; slot_ctr < GPU_SLOTS; slot_ctr++, next_slot = (next_slot + 1) % GPU_SLOTS) {
+    gpu_slot_t *slot = &gpu->slots[next_slot];
+
+    if (slot->done == NULL) continue;
+
+    if (failed) {
+      gpu_discard(slot);
+    } else if (!gpu_complete(slot)) {
+      failed = 1;
+    } else {
+      done += slot->len;
+      key_pos = slot->key_pos;
+    }
+  }
+
+  clReleaseMemObject(shifts);
+  key_state->key_pos = key_pos;
+  gpu_release(gpu);
+  return done;
+}
+#endif
+
+/**
+ * Histograms are gathered HISTOGRAM_BLOCK_SIZE characters at a time - the pairs of each
+ * block (see PAIR_SHIFT) are recorded by the kernel whilst transforming it, and tallied
+ * whilst they remain within the L1 cache, hence the message is still only read from (and
+ * written to) memory once.
+ *
+ * The pairs are tallied within 32-bit tables, which are folded into the histogram every 
+ * HISTOGRAM_RUN_SIZE bytes (well before any could overflow).
+ *
+ * Tallying costs roughly as much as the transformation itself (an increment per character),
+ * hence a histogram may instead be sampled (see vigenere_histogram_t.sample) - the blocks in
+ * between those counted are transformed by the kernel at full speed, with a single call.
+ */
+#define HISTOGRAM_BLOCK_SIZE (4 * 1024)
+#define HISTOGRAM_RUN_SIZE (1024 * 1024 * 1024)
+#define HISTOGRAM_TABLES 4
+
+/**
+ * Tallies each pair within tables[pair]. The pairs are read eight at a time, spread across
+ * the tables - a run of the same character therefore does not serialise upon a single counter
+ * (each increment would otherwise wait upon the previous). Four tables suffice for this, and
+ * are half as many to clear and fold, which is otherwise most of the cost of a sampled call.
+ */
+static void
+tally_pairs(const uint16_t *pairs, size_t pair_count, uint32_t tables[HISTOGRAM_TABLES][PAIR_SPACE]) {
+  size_t pair_ctr = 0;
+
+  for (; pair_ctr + 8 <= pair_count; pair_ctr += 8) {
+    uint64_t lower, upper;
+
+    // written out, as the compiler otherwise keeps the loop (and spills the shifted words).
+    memcpy(&lower, pairs + pair_ctr, sizeof(lower));
+    memcpy(&upper, pairs + pair_ctr + 4, sizeof(upper));
+    tables[0][lower & 0xFFFF]++;
+    tables[1][(lower >> 16) & 0xFFFF]++;
+    tables[2][(lower >> 32) & 0xFFFF]++;
+    tables[3][lower >> 48]++;
+    tables[0][upper & 0xFFFF]++;
+    tables[1][(upper >> 16) & 0xFFFF]++;
+    tables[2][(upper >> 32) & 0xFFFF]++;
+    tables[3][upper >> 48]++;
+  }
+
+  for (; pair_ctr < pair_count; pair_ctr++) tables[0][pairs[pair_ctr]]++;
+}
+
+/**
+ * Adds the tallies of each pair to histogram - that is, to the input letter's count and to
+ * that of the output letter (of pairs besides PAIR_NONE).
+ */
+static void
+fold_pairs(uint32_t tables[HISTOGRAM_TABLES][PAIR_SPACE], vigenere_histogram_t *histogram) {
+  for (int input = 0; input <= PAIR_NONE; input++) {
+    for (int output = 0; output <= PAIR_NONE; output++) {
+      unsigned long long count = 0;
+
+      for (int table_ctr = 0; table_ctr < HISTOGRAM_TABLES; table_ctr++)
+        count += tables[table_ctr][input | output << PAIR_SHIFT];
+
+      if (input != PAIR_NONE) histogram->input[input] += count;
+      if (output != PAIR_NONE) histogram->output[output] += count;
+    }
+  }
+}
+
+/**
+ * Transforms input into output using the kernel (as kernel->transform() would), whilst adding
+ * the letters of each to histogram - one block of HISTOGRAM_BLOCK_SIZE characters at a time,
+ * or one block in every histogram->sample. Kernels without vectors to record the pairs from
+ * (kernel->pair) are paired by pair_scalar().
+ *
+ * The tables are only cleared (and folded) should a block be counted, as a call of a single
+ * stream chunk would otherwise spend as long upon them as upon the chunk itself.
+ */
+static void
+transform_counted(const kernel_t *kernel, const char *input, char *output, size_t len, key_state_t *key_state,
+                  modes_t mode, vigenere_histogram_t *histogram) {
+  const unsigned long long sample = histogram->sample > 1 ? histogram->sample : 1;
+  uint32_t tables[HISTOGRAM_TABLES][PAIR_SPACE];
+  uint16_t pairs[HISTOGRAM_BLOCK_SIZE];
+  size_t tallied = 0; // the characters tallied since the tables were last folded.
+
+  for (size_t offset = 0; offset < len;) {
+    const size_t remaining = len - offset;
+    const unsigned long long phase = histogram->blocks % sample;
+
+    // The blocks preceding the next to be counted (continuing from the previous call) are skipped.
+    if (phase != 0) {
+      const unsigned long long skipped = sample - phase;
+      const size_t skip_len = skipped <= remaining / HISTOGRAM_BLOCK_SIZE ? (size_t)skipped * HISTOGRAM_BLOCK_SIZE : remaining;
+
+      kernel->transform(input + offset, output + offset, skip_len, key_state, mode);
+      histogram->blocks += (skip_len + HISTOGRAM_BLOCK_SIZE - 1) / HISTOGRAM_BLOCK_SIZE;
+      offset += skip_len;
+      continue;
+    }
+
+    const size_t block_len = remaining < HISTOGRAM_BLOCK_SIZE ? remaining : HISTOGRAM_BLOCK_SIZE;
+
+    if (tallied == 0) memset(tables, 0, sizeof(tables));
+    if (kernel->pair != NULL) kernel->pair(input + offset, output + offset, block_len, key_state, mode, pairs);
+    else pair_scalar(kernel->transform, input + offset, output + offset, block_len, key_state, mode, pairs);
+    tally_pairs(pairs, block_len, tables);
+
+    histogram->blocks++;
+    histogram->counted += block_len;
+    tallied += block_len;
+    offset += block_len;
+
+    if (tallied >= HISTOGRAM_RUN_SIZE) {
+      fold_pairs(tables, histogram);
+      tallied = 0;
+    }
+  }
+
+  if (tallied > 0) fold_pairs(tables, histogram);
+}
+
+/**
+ * The index of coincidence is the probability that two letters drawn from the text are
+ * the same (see vigenere_analysis_ioc()) - ~0.066 for English, and ~0.038 (1/26) for 
+ * uniformly random text, such as a well-enciphered message.
+ */
+double
+vigenere_histogram_ioc(const unsigned long long *counts) {
+  double total = 0, coincidences = 0;
+
+  for (int letter = 0; letter < CHAR_SPACE; letter++) {
+    total += (double)counts[letter];
+    coincidences += (double)counts[letter] * ((double)counts[letter] - 1);
+  }
+
+  return total > 1 ? coincidences / (total * (total - 1)) : 0;
+}
+
+/**
+ * This structure holds a single chunk of a buffer being transformed in parallel,
+ * alongside the results (count) and state (key_state) of the thread processing it.
+ */
+typedef struct chunk {
+  const char *input; // the start of the chunk within the input buffer.
+  char *output; // the start of the chunk within the output buffer.
+  size_t text_len; // length of the chunk.
+  size_t count; // number of alphabetic characters within the chunk.
+  key_state_t key_state; // key state at the start of the chunk.
+  modes_t mode; // encrypt/decrypt operation.
+  const kernel_t *kernel; // the kernel of the key state's alphabet.
+  vigenere_histogram_t *histogram; // the letter counts of this chunk (see transform_counted()), or NULL.
+} chunk_t;
+
+// Thread entry point for the first pass - counts the alphabetic characters of a chunk.
+static void *
+count_chunk(void *arg) {
+  chunk_t *chunk = (chunk_t *)arg;
+  chunk->count = chunk->kernel->count(chunk->input, chunk->text_len);
+  return NULL;
+}
+
+// Thread entry point for the second pass - transforms a chunk from its starting key position.
+static void *
+transform_chunk(void *arg) {
+  chunk_t *chunk = (chunk_t *)arg;
+
+  if (chunk->histogram != NULL) transform_counted(chunk->kernel, chunk->input, chunk->output, chunk->text_len, 
+                                                  &chunk->key_state, chunk->mode, chunk->histogram);
+  else chunk->kernel->transform(chunk->input, chunk->output, chunk->text_len, &chunk->key_state, chunk->mode);
+  return NULL;
+}
+
+/**
+ * This function runs routine() on each of the items (i.e., chunks), one thread per item,
+ * whereby the items are item_size bytes apart.
+ *
+ * The first item is processed upon the calling thread. Should a thread fail to be 
+ * created (or threads are unavailable), its item is simply processed inline.
+ */
+static void
+run_threads(void *(*routine)(void *), void *items, size_t item_size, int item_count) {
+  char *item = (char *)items;
+
+#ifdef VIGENERE_THREADS
+  pthread_t threads[MAX_THREADS];
+  int created[MAX_THREADS] = { 0 };
+
+  for (int item_ctr = 1; item_ctr < item_count; item_ctr++)
+    created[item_ctr] = pthread_create(&threads[item_ctr], NULL, routine, item + item_ctr * item_size) == 0;
+
+  routine(item);
+
+  for (int item_ctr = 1; item_ctr < item_count; item_ctr++)
+    if (created[item_ctr]) pthread_join(threads[item_ctr], NULL);
+    else routine(item + item_ctr * item_size);
+#else
+  for (int item_ctr = 0; item_ctr < item_count; item_ctr++)
+    routine(item + item_ctr * item_size);
+#endif
+}
+
+/**
+ * This function transforms input into output (which may be the same buffer) using
+ * multiple threads, producing output identical to that of vigenere_transform_into().
+ *
+ * As only alphabetic characters advance the key, the key position at the start of
+ * each chunk depends upon all of the preceding chunks. This is therefore performed 
+ * within two passes:
+ *
+ * 1. The buffer is split into (threads) chunks, and the alphabetic characters of
+ *    each are counted in parallel.
+ * 2. A prefix sum of the counts yields the starting key position of each chunk,
+ *    following which every chunk is transformed in parallel.
+ *
+ * The count is significantly cheaper than the transformation itself, hence this
+ * scales with the number of threads until memory bandwidth is saturated.
+ *
+ * Should histogram be non-NULL, each chunk counts its letters within its own histogram
+ * (see transform_counted()), and these are added to histogram once the threads are joined.
+ *
+ * Compiled with -DVIGENERE_OPENCL, buffers of at least GPU_MIN_SIZE bytes are first
+ * offered to the GPU (see gpu_transform()), which splits them in the same manner.
+ */
+static size_t
+transform_parallel(const char *input, char *output, size_t len, key_state_t *key_state, 
+                   modes_t mode, int threads, vigenere_histogram_t *histogram) {
+  chunk_t chunks[MAX_THREADS];
+  vigenere_histogram_t histograms[MAX_THREADS];
+
+#ifdef VIGENERE_OPENCL
+  // The GPU gathers no histogram, as its output is copied straight to its destination.
+  if (len >= GPU_MIN_SIZE && histogram == NULL) {
+    const size_t offloaded = gpu_transform(input, output, len, key_state, mode, threads);
+
+    input += offloaded;
+    output += offloaded;
+    len -= offloaded;
+    if (len == 0) return key_state->key_pos;
+  }
+#endif
+
+  if (threads > MAX_THREADS) threads = MAX_THREADS;
+  if (threads <= 1 || len < PARALLEL_MIN_SIZE || key_state->autokey != NULL) {
+    if (histogram == NULL) return vigenere_transform_into(input, output, len, key_state, mode);
+
+    transform_counted(key_state_kernel(key_state), input, output, len, key_state, mode, histogram);
+    return key_state->key_pos;
+  }
+
+  // The kernel must be selected prior to the threads being created.
+  const kernel_t *kernel = key_state_kernel(key_state);
+
+  const size_t chunk_len = len / threads;
+
+  for (int chunk_ctr = 0; chunk_ctr < threads; chunk_ctr++) {
+    chunks[chunk_ctr].input = input + chunk_ctr * chunk_len;
+    chunks[chunk_ctr].output = output + chunk_ctr * chunk_len;
+    chunks[chunk_ctr].text_len = chunk_ctr == threads - 1 ? len - chunk_ctr * chunk_len : chunk_len;
+    chunks[chunk_ctr].key_state = *key_state;
+    chunks[chunk_ctr].mode = mode;
+    chunks[chunk_ctr].kernel = kernel;
+    chunks[chunk_ctr].histogram = histogram != NULL ? &histograms[chunk_ctr] : NULL;
+    if (histogram != NULL) {
+      // Each chunk samples from where the histogram left off (see transform_counted()).
+      memset(&histograms[chunk_ctr], 0, sizeof(vigenere_histogram_t));
+      histograms[chunk_ctr].sample = histogram->sample;
+      histograms[chunk_ctr].blocks = histogram->blocks;
+    }
+  }
+
+  run_threads(count_chunk, chunks, sizeof(chunk_t), threads);
+
+  // Exclusive prefix sum - each chunk starts where the preceding chunk finishes.
+  size_t key_pos = key_state->key_pos;
+  for (int chunk_ctr = 0; chunk_ctr < threads; chunk_ctr++) {
+    chunks[chunk_ctr].key_state.key_pos = key_pos;
+    key_pos = (key_pos + chunks[chunk_ctr].count) % key_state->key_len;
+  }
+
+  run_threads(transform_chunk, chunks, sizeof(chunk_t), threads);
+
+  const unsigned long long blocks = histogram != NULL ? histogram->blocks : 0;
+  for (int chunk_ctr = 0; histogram != NULL && chunk_ctr < threads; chunk_ctr++) {
+    for (int letter = 0; letter < CHAR_SPACE; letter++) {
+      histogram->input[letter] += histograms[chunk_ctr].input[letter];
+      histogram->output[letter] += histograms[chunk_ctr].output[letter];
+    }
+
+    histogram->blocks += histograms[chunk_ctr].blocks - blocks;
+    histogram->counted += histograms[chunk_ctr].counted;
+  }
+
+  key_state->key_pos = key_pos;
+  return key_pos;
+}
+
+size_t
+vigenere_transform_parallel(const char *input, char *output, size_t len, key_state_t *key_state, 
+                            modes_t mode, int threads) {
+  return transform_parallel(input, output, len, key_state, mode, threads, NULL);
+}
+
+size_t
+vigenere_transform_histogram(const char *input, char *output, size_t len, key_state_t *key_state,
+                             modes_t mode, int threads, vigenere_histogram_t *histogram) {
+  return transform_parallel(input, output, len, key_state, mode, threads, histogram);
+}
+
+/**
+* This function fills shifts with the shift for each of the key_len characters of key,
+* followed by KEY_RING_PADDING repeated shifts. shifts must therefore be (at least)
+* key_len + KEY_RING_PADDING bytes.
+*/
+void
+vigenere_fill_shifts(const char *key, size_t key_len, unsigned char *shifts) {
+  for (size_t key_ctr = 0; key_ctr < key_len; key_ctr++) {
+
+    /**
+    * Each key character is converted to its position within the alphabet (A = 0, Z = 25).
+    *
+    * Non-alphabetic key characters are reduced into the same 0-25 range, with 26 added
+    * prior to the final modulo so that the result is never negative.
+    */
+    int shift = (toupper((unsigned char)key[key_ctr]) - ASCII_HIGHER_OFFSET) % CHAR_SPACE;
+    shifts[key_ctr] = (unsigned char)((shift + CHAR_SPACE) % CHAR_SPACE);
+  }
+
+  // The shifts are then repeated past the end of the key (i.e., KEY -> KEYKEYKEY...).
+  for (size_t key_ctr = key_len; key_ctr < key_len + KEY_RING_PADDING; key_ctr++)
+    shifts[key_ctr] = shifts[key_ctr - key_len];
+}
+
+int
+vigenere_fill_gronsfeld_shifts(const char *key, size_t key_len, unsigned char *shifts) {
+  for (size_t key_ctr = 0; key_ctr < key_len; key_ctr++) {
+    if (!isdigit((unsigned char)key[key_ctr])) return -1;
+    shifts[key_ctr] = (unsigned char)(key[key_ctr] - '0');
+  }
+
+  for (size_t key_ctr = key_len; key_ctr < key_len + KEY_RING_PADDING; key_ctr++)
+    shifts[key_ctr] = shifts[key_ctr - key_len];
+
+  return 0;
+}
+
+void
+vigenere_fill_shifts_alphabet(const char *key, size_t key_len, alphabet_t alphabet, unsigned char *shifts) {
+  const int space = alphabet_spaces[alphabet];
+
+  if (alphabet == Letters) {
+    vigenere_fill_shifts(key, key_len, shifts);
+    return;
+  }
+
+  // Key characters outside of the alphabet are reduced into it, as with the letters.
+  for (size_t key_ctr = 0; key_ctr < key_len; key_ctr++) {
+    const int index = symbol_index((unsigned char)key[key_ctr], space);
+    shifts[key_ctr] = (unsigned char)(index >= 0 ? index : (unsigned char)key[key_ctr] % space);
+  }
+
+  for (size_t key_ctr = key_len; key_ctr < key_len + KEY_RING_PADDING; key_ctr++)
+    shifts[key_ctr] = shifts[key_ctr - key_len];
+}
+
+// Returns the first byte available for allocation within a block (following its header).
+static inline unsigned char *
+block_data(vigenere_arena_block_t *block) {
+  return (unsigned char *)(block + 1);
+}
+
+// Returns the number of bytes by which address falls short of VIGENERE_ARENA_ALIGNMENT.
+static inline size_t
+align_padding(const void *address) {
+  return (size_t)(-(uintptr_t)address & (VIGENERE_ARENA_ALIGNMENT - 1));
+}
+
+void
+vigenere_arena_init(vigenere_arena_t *arena, void *buffer, size_t len) {
+  arena->first = arena->current = NULL;
+  arena->used = 0;
+
+  // The header of the first block is placed at the start of the buffer itself.
+  if (buffer == NULL || len < align_padding(buffer) + sizeof(vigenere_arena_block_t)) return;
+
+  vigenere_arena_block_t *block = (vigenere_arena_block_t *)((unsigned char *)buffer + align_padding(buffer));
+
+  block->next = NULL;
+  block->capacity = len - align_padding(buffer) - sizeof(vigenere_arena_block_t);
+  block->owned = 0;
+  arena->first = arena->current = block;
+}
+
+/**
+ * The allocation is taken from the current block should it fit. Otherwise, the following
+ * block is used (should it be large enough), as retained by a previous reset - failing that,
+ * a block is allocated, and inserted after the current block.
+ *
+ * The alignment is of the address of each allocation, as opposed to its offset within the
+ * block, as malloc() only guarantees the alignment of the fundamental types (i.e, 16 bytes).
+ */
+void *
+vigenere_arena_alloc(vigenere_arena_t *arena, size_t size) {
+  vigenere_arena_block_t *block = arena->current;
+
+  while (block != NULL) {
+    const size_t offset = arena->used + align_padding(block_data(block) + arena->used);
+
+    if (offset <= block->capacity && size <= block->capacity - offset) {
+      arena->used = offset + size;
+      return block_data(block) + offset;
+    }
+
+    if (block->next == NULL || block->next->capacity < size + VIGENERE_ARENA_ALIGNMENT) break;
+
+    block = arena->current = block->next;
+    arena->used = 0;
+  }
+
+  const size_t capacity = (size > VIGENERE_ARENA_BLOCK_SIZE ? size : VIGENERE_ARENA_BLOCK_SIZE) + VIGENERE_ARENA_ALIGNMENT;
+  vigenere_arena_block_t *new_block = (vigenere_arena_block_t *)malloc(sizeof(vigenere_arena_block_t) + capacity);
+
+  if (new_block == NULL) return NULL;
+
+  new_block->capacity = capacity;
+  new_block->owned = 1;
+
+  if (block != NULL) {
+    new_block->next = block->next;
+    block->next = new_block;
+  } else {
+    new_block->next = arena->first;
+    arena->first = new_block;
+  }
+
+  arena->current = new_block;
+  arena->used = align_padding(block_data(new_block)) + size;
+  return block_data(new_block) + align_padding(block_data(new_block));
+}
+
+vigenere_arena_mark_t
+vigenere_arena_mark(const vigenere_arena_t *arena) {
+  vigenere_arena_mark_t mark;
+
+  mark.block = arena->current;
+  mark.used = arena->used;
+  return mark;
+}
+
+void
+vigenere_arena_rewind(vigenere_arena_t *arena, vigenere_arena_mark_t mark) {
+  // A mark taken from an empty arena precedes every block.
+  arena->current = mark.block != NULL ? mark.block : arena->first;
+  arena->used = mark.block != NULL ? mark.used : 0;
+}
+
+void
+vigenere_arena_reset(vigenere_arena_t *arena) {
+  arena->current = arena->first;
+  arena->used = 0;
+}
+
+void
+vigenere_arena_release(vigenere_arena_t *arena) {
+  vigenere_arena_block_t *block = arena->first, *next = NULL, *caller_block = NULL;
+
+  for (; block != NULL; block = next) {
+    next = block->next;
+
+    if (block->owned) free(block);
+    else caller_block = block;
+  }
+
+  // The backing buffer (if any) remains usable, as though the arena were just initialised.
+  if (caller_block != NULL) caller_block->next = NULL;
+  arena->first = arena->current = caller_block;
+  arena->used = 0;
+}
+
+/**
+ * This structure holds the state of a streaming context (see vigenere.h).
+ *
+ * The context owns its shift table, which is allocated once by vigenere_init() - 
+ * vigenere_update() therefore performs no allocations, regardless of the number of
+ * calls or the amount of data.
+ */
+struct vigenere_ctx {
+  key_state_t key_state; // the shift table, and the position within it.
+  unsigned char *shifts; // the shift table (owned by the context).
+  modes_t mode; // encrypt/decrypt operation.
+  int in_arena; // non-zero should the context have been allocated from an arena.
+};
+
+// Prepares a context (allocated by the caller) and its shift table for the key.
+static vigenere_ctx_t *
+prepare_ctx(vigenere_ctx_t *ctx, const char *key, size_t key_len, modes_t mode, int in_arena) {
+  vigenere_fill_shifts(key, key_len, ctx->shifts);
+  ctx->key_state.shifts = ctx->shifts;
+  ctx->key_state.key_len = key_len;
+  ctx->key_state.key_pos = 0;
+  ctx->key_state.alphabet = Letters;
+  ctx->key_state.autokey = NULL;
+  ctx->key_state.cipher = Vigenere;
+  ctx->mode = mode;
+  ctx->in_arena = in_arena;
+
+  return ctx;
+}
+
+vigenere_ctx_t *
+vigenere_init(const char *key, modes_t mode) {
+  const size_t key_len = key != NULL ? strlen(key) : 0;
+  vigenere_ctx_t *ctx = NULL;
+
+  // An empty key would otherwise result in a division by zero (key_pos % 0).
+  if (key_len == 0 || (ctx = (vigenere_ctx_t *)malloc(sizeof(vigenere_ctx_t))) == NULL) return NULL;
+
+  if ((ctx->shifts = (unsigned char *)malloc(key_len + KEY_RING_PADDING)) == NULL) {
+    free(ctx);
+    return NULL;
+  }
+
+  return prepare_ctx(ctx, key, key_len, mode, 0);
+}
+
+vigenere_ctx_t *
+vigenere_init_arena(const char *key, modes_t mode, vigenere_arena_t *arena) {
+  const size_t key_len = key != NULL ? strlen(key) : 0;
+  vigenere_ctx_t *ctx = NULL;
+
+  if (key_len == 0 || (ctx = (vigenere_ctx_t *)vigenere_arena_alloc(arena, sizeof(vigenere_ctx_t))) == NULL) return NULL;
+  if ((ctx->shifts = (unsigned char *)vigenere_arena_alloc(arena, key_len + KEY_RING_PADDING)) == NULL) return NULL;
+
+  return prepare_ctx(ctx, key, key_len, mode, 1);
+}
+
+size_t
+vigenere_update(vigenere_ctx_t *ctx, const char *input, char *output, size_t len) {
+  return vigenere_transform_into(input, output, len, &ctx->key_state, ctx->mode);
+}
+
+void
+vigenere_reset(vigenere_ctx_t *ctx) {
+  ctx->key_state.key_pos = 0;
+}
+
+void
+vigenere_free(vigenere_ctx_t *ctx) {
+  if (ctx == NULL || ctx->in_arena) return;
+
+  free(ctx->shifts);
+  free(ctx);
+}
+
+/**
+ * The relative frequencies of the letters (A-Z) within English text, against which each
+ * coset is fitted by the analysis.
+ *
+ * https://en.wikipedia.org/wiki/Letter_frequency
+ */
+static const double english_frequencies[CHAR_SPACE] = {
+  0.08167, 0.01492, 0.02782, 0.04253, 0.12702, 0.02228, 0.02015, 0.06094, 0.06966,
+  0.00153, 0.00772, 0.04025, 0.02406, 0.06749, 0.07507, 0.01929, 0.00095, 0.05987,
+  0.06327, 0.09056, 0.02758, 0.00978, 0.02360, 0.00150, 0.01974, 0.00074
+};
+
+// The index of coincidence of English and of uniformly random text (1/26) respectively.
+#define ENGLISH_IOC 0.0667
+#define RANDOM_IOC (1.0 / CHAR_SPACE)
+
+/**
+ * The number of bytes classified at once by vigenere_analysis_update(), whereby the
+ * letters of each block are compacted prior to updating the histograms.
+ */
+#define ANALYSIS_BLOCK_SIZE 4096
+
+/**
+ * The largest modulus whose histograms may be accumulated (see choose_moduli()), which
+ * bounds each to CHAR_SPACE * 1024 counters (104 KiB).
+ */
+#define ANALYSIS_MAX_MODULUS 1024
+
+/**
+ * The histograms are 32-bit (halving their footprint), hence these are added to the
+ * 64-bit totals before any could overflow - that is, after this many letters.
+ */
+#define ANALYSIS_FLUSH_LETTERS ((size_t)1 << 31)
+
+/**
+ * This structure holds the state of an analysis (see vigenere.h).
+ *
+ * The cosets of period p (every p-th letter, starting from each of 0 to p - 1) are not
+ * counted directly. Rather, a histogram of CHAR_SPACE counts is kept for each residue of
+ * a few moduli, of which every period divides at least one - the coset c of period p is
+ * then the sum of residues c, c + p, c + 2p, ... of its modulus m (as p divides m).
+ *
+ * For instance, every period of 1 to 32 divides one of 840, 594, 416, 323, 575 or 899,
+ * hence 6 histograms are updated per letter, as opposed to 32.
+ *
+ * residues[m] is the residue of the next letter for modulus m (i.e., letters % m), which
+ * is advanced as opposed to being recomputed, avoiding a division per letter.
+ */
+struct vigenere_analysis {
+  size_t max_period; // the longest period considered.
+  size_t letters; // the number of letters accumulated.
+  size_t pending; // letters accumulated since the histograms were added to the totals.
+  size_t modulus_count; // the number of moduli.
+  size_t moduli[VIGENERE_MAX_PERIOD]; // the moduli whose residues are counted.
+  size_t offsets[VIGENERE_MAX_PERIOD + 1]; // the offset of the histograms of each modulus.
+  size_t residues[VIGENERE_MAX_PERIOD]; // the residue of the next letter, per modulus.
+  size_t period_moduli[VIGENERE_MAX_PERIOD + 1]; // the index of the modulus of each period.
+  unsigned int *histograms; // the counts accumulated since the last flush.
+  unsigned long long *totals; // the counts flushed from the histograms.
+};
+
+/**
+ * Chooses the moduli, such that every period (1 to max_period) divides one of them.
+ *
+ * This is performed greedily - the modulus (up to ANALYSIS_MAX_MODULUS) dividing the most
+ * periods yet to be covered is chosen (the smallest, should several tie), until none
+ * remain. Returns the total number of residues, and thus histograms.
+ */
+static size_t
+choose_moduli(vigenere_analysis_t *analysis) {
+  int covered[VIGENERE_MAX_PERIOD + 1] = { 0 };
+  size_t remaining = analysis->max_period, residues = 0;
+
+  while (remaining > 0) {
+    size_t best_modulus = 0, best_gain = 0;
+
+    for (size_t modulus = 1; modulus <= ANALYSIS_MAX_MODULUS; modulus++) {
+      size_t gain = 0;
+
+      for (size_t period = 1; period <= analysis->max_period; period++) gain += !covered[period] && modulus % period == 0;
+      if (gain > best_gain) {
+        best_modulus = modulus;
+        best_gain = gain;
+      }
+    }
+
+    for (size_t period = 1; period <= analysis->max_period; period++) {
+      if (covered[period] || best_modulus % period != 0) continue;
+
+      covered[period] = 1;
+      analysis->period_moduli[period] = analysis->modulus_count;
+      remaining--;
+    }
+
+    analysis->offsets[analysis->modulus_count] = residues * CHAR_SPACE;
+    analysis->moduli[analysis->modulus_count++] = best_modulus;
+    residues += best_modulus;
+  }
+
+  analysis->offsets[analysis->modulus_count] = residues * CHAR_SPACE;
+  return residues;
+}
+
+// Adds the histograms to the totals, and then clears them.
+static void
+flush_histograms(vigenere_analysis_t *analysis) {
+  const size_t counters = analysis->offsets[analysis->modulus_count];
+
+  for (size_t counter_ctr = 0; counter_ctr < counters; counter_ctr++)
+    analysis->totals[counter_ctr] += analysis->histograms[counter_ctr];
+
+  memset(analysis->histograms, 0, counters * sizeof(unsigned int));
+  analysis->pending = 0;
+}
+
+vigenere_analysis_t *
+vigenere_analysis_init(size_t max_period) {
+  vigenere_analysis_t *analysis = NULL;
+
+  if (max_period < 1 || max_period > VIGENERE_MAX_PERIOD) return NULL;
+  if ((analysis = (vigenere_analysis_t *)calloc(1, sizeof(vigenere_analysis_t))) == NULL) return NULL;
+
+  analysis->max_period = max_period;
+
+  const size_t counters = choose_moduli(analysis) * CHAR_SPACE;
+
+  analysis->histograms = (unsigned int *)calloc(counters, sizeof(unsigned int));
+  analysis->totals = (unsigned long long *)calloc(counters, sizeof(unsigned long long));
+
+  if (analysis->histograms == NULL || analysis->totals == NULL) {
+    vigenere_analysis_free(analysis);
+    return NULL;
+  }
+
+  return analysis;
+}
+
+/**
+ * The ciphertext is read once, in blocks of ANALYSIS_BLOCK_SIZE bytes. Each block is first
+ * compacted into the alphabetic indices (0-25) of its letters, from which the histograms
+ * of each modulus are then updated in turn.
+ *
+ * Updating one modulus at a time keeps the compacted letters within the L1 cache (and the
+ * histograms within the L2 cache).
+ */
+void
+vigenere_analysis_update(vigenere_analysis_t *analysis, const char *text, size_t len) {
+  unsigned char letters[ANALYSIS_BLOCK_SIZE];
+
+  for (size_t block = 0; block < len; block += ANALYSIS_BLOCK_SIZE) {
+    const size_t block_len = len - block < ANALYSIS_BLOCK_SIZE ? len - block : ANALYSIS_BLOCK_SIZE;
+    size_t letter_count = 0;
+
+    /**
+    * ('c' | 0x20) - 'a' is below 26 only for A-Z and a-z (see ASCII_LOWER_OFFSET) - the same
+    * characters for which isalpha() is true, and which advance the key whilst transforming.
+    *
+    * The index is always stored, but only kept (by advancing letter_count) for letters.
+    */
+    for (size_t text_ctr = 0; text_ctr < block_len; text_ctr++) {
+      const unsigned char index = (unsigned char)(((unsigned char)text[block + text_ctr] | 0x20) - ASCII_LOWER_OFFSET);
+
+      letters[letter_count] = index;
+      letter_count += index < CHAR_SPACE;
+    }
+
+    if (analysis->pending + letter_count > ANALYSIS_FLUSH_LETTERS) flush_histograms(analysis);
+
+    for (size_t modulus_ctr = 0; modulus_ctr < analysis->modulus_count; modulus_ctr++) {
+      unsigned int *histograms = analysis->histograms + analysis->offsets[modulus_ctr];
+      const size_t modulus = analysis->moduli[modulus_ctr];
+      size_t residue = analysis->residues[modulus_ctr];
+
+      /**
+      * The letters are taken in runs which end where the residue wraps (to 0), so that
+      * the histogram of each letter is simply that of the previous letter plus CHAR_SPACE.
+      */
+      for (size_t letter_ctr = 0; letter_ctr < letter_count;) {
+        const size_t run = modulus - residue < letter_count - letter_ctr ? modulus - residue : letter_count - letter_ctr;
+        unsigned int *histogram = histograms + residue * CHAR_SPACE;
+
+        for (size_t run_ctr = 0; run_ctr < run; run_ctr++, histogram += CHAR_SPACE) histogram[letters[letter_ctr + run_ctr]]++;
+
+        letter_ctr += run;
+        residue = (residue + run) % modulus;
+      }
+
+      analysis->residues[modulus_ctr] = residue;
+    }
+
+    analysis->letters += letter_count;
+    analysis->pending += letter_count;
+  }
+}
+
+size_t
+vigenere_analysis_letters(const vigenere_analysis_t *analysis) {
+  return analysis->letters;
+}
+
+// Stores the counts of the coset of the period within counts, summed from its modulus.
+static size_t
+coset_counts(const vigenere_analysis_t *analysis, size_t period, size_t coset, unsigned long long *counts) {
+  const size_t modulus_ctr = analysis->period_moduli[period], modulus = analysis->moduli[modulus_ctr];
+  size_t total = 0;
+
+  memset(counts, 0, CHAR_SPACE * sizeof(unsigned long long));
+
+  for (size_t residue = coset; residue < modulus; residue += period) {
+    const size_t offset = analysis->offsets[modulus_ctr] + residue * CHAR_SPACE;
+
+    for (int letter = 0; letter < CHAR_SPACE; letter++)
+      counts[letter] += analysis->totals[offset + letter] + analysis->histograms[offset + letter];
+  }
+
+  for (int letter = 0; letter < CHAR_SPACE; letter++) total += counts[letter];
+  return total;
+}
+
+/**
+ * The index of coincidence is the probability that two letters drawn from the coset are
+ * the same, that is, sum(n * (n - 1)) / (N * (N - 1)). A shift does not alter this, hence
+ * the cosets of the correct period resemble English (~0.066), and others random text.
+ *
+ * https://en.wikipedia.org/wiki/Index_of_coincidence
+ */
+double
+vigenere_analysis_ioc(const vigenere_analysis_t *analysis, size_t period) {
+  unsigned long long counts[CHAR_SPACE];
+  double ioc = 0;
+
+  if (period < 1 || period > analysis->max_period || analysis->letters < 2 * period) return 0;
+
+  for (size_t coset = 0; coset < period; coset++) {
+    const double total = (double)coset_counts(analysis, period, coset, counts);
+    double coincidences = 0;
+
+    for (int letter = 0; letter < CHAR_SPACE; letter++) coincidences += (double)counts[letter] * ((double)counts[letter] - 1);
+    if (total > 1) ioc += coincidences / (total * (total - 1));
+  }
+
+  return ioc / (double)period;
+}
+
+/**
+ * As the index of coincidence of the whole ciphertext is a mixture of the English and the
+ * random indices (weighted by the key length), this may be solved for the key length:
+ * L = (ENGLISH_IOC - RANDOM_IOC) / (ioc - RANDOM_IOC).
+ *
+ * https://en.wikipedia.org/wiki/Vigen%C3%A8re_cipher#Friedman_test
+ */
+double
+vigenere_analysis_friedman(const vigenere_analysis_t *analysis) {
+  const double ioc = vigenere_analysis_ioc(analysis, 1);
+
+  return ioc > RANDOM_IOC ? (ENGLISH_IOC - RANDOM_IOC) / (ioc - RANDOM_IOC) : 0;
+}
+
+/**
+ * Recovers the shift of a coset, that is, the shift for which the deciphered coset best
+ * fits English (the lowest chi-squared statistic). Encrypting adds the shift, hence the
+ * deciphered count of each letter is that of the letter shift places after it.
+ *
+ * The statistic is divided by the size of the coset, so that the cosets of different
+ * periods (and thus sizes) may be compared. score receives this statistic.
+ *
+ * https://en.wikipedia.org/wiki/Chi-squared_test
+ */
+static int
+fit_coset(const unsigned long long *counts, size_t total, double *score) {
+  int best_shift = 0;
+  double best_score = 0;
+
+  for (int shift = 0; shift < CHAR_SPACE; shift++) {
+    double chi_squared = 0;
+
+    for (int letter = 0; letter < CHAR_SPACE; letter++) {
+      const double expected = english_frequencies[letter] * (double)total,
+                   difference = (double)counts[(letter + shift) % CHAR_SPACE] - expected;
+
+      chi_squared += difference * difference / expected;
+    }
+
+    if (shift == 0 || chi_squared < best_score) {
+      best_shift = shift;
+      best_score = chi_squared;
+    }
+  }
+
+  *score = best_score / (double)total;
+  return best_shift;
+}
+
+// Returns non-zero should key (of length period) repeat a shorter key (i.e., LEMONLEMON).
+static int
+repeats_shorter_key(const char *key, size_t period) {
+  for (size_t divisor = 1; divisor < period; divisor++) {
+    if (period % divisor != 0) continue;
+    if (memcmp(key, key + divisor, period - divisor) == 0) return 1;
+  }
+
+  return 0;
+}
+
+size_t
+vigenere_analysis_rank(const vigenere_analysis_t *analysis, vigenere_candidate_t *candidates, size_t count) {
+  unsigned long long counts[CHAR_SPACE];
+  size_t stored = 0;
+
+  /**
+  * Every period (with at least two letters per coset) yields a candidate, which is then
+  * inserted into the candidates in order of its score - retaining only the best count.
+  */
+  for (size_t period = 1; period <= analysis->max_period && analysis->letters >= 2 * period; period++) {
+    vigenere_candidate_t candidate;
+    double score = 0;
+
+    candidate.period = period;
+    candidate.ioc = vigenere_analysis_ioc(analysis, period);
+    candidate.score = 0;
+
+    for (size_t coset = 0; coset < period; coset++) {
+      const size_t total = coset_counts(analysis, period, coset, counts);
+
+      candidate.key[coset] = (char)(ASCII_HIGHER_OFFSET + fit_coset(counts, total, &score));
+      candidate.score += score / (double)period;
+    }
+
+    candidate.key[period] = '\0';
+    if (repeats_shorter_key(candidate.key, period)) continue;
+
+    // Shift the worse candidates down, discarding the last should there be no room.
+    size_t position = stored < count ? stored++ : count;
+
+    while (position > 0 && candidates[position - 1].score > candidate.score) {
+      if (position < count) candidates[position] = candidates[position - 1];
+      position--;
+    }
+
+    if (position < count) candidates[position] = candidate;
+  }
+
+  return stored;
+}
+
+void
+vigenere_analysis_free(vigenere_analysis_t *analysis) {
+  if (analysis == NULL) return;
+
+  free(analysis->histograms);
+  free(analysis->totals);
+  free(analysis);
+}
+
+/**
+ * The number of letters of the ciphertext against which each key is tried by the search.
+ * As only this prefix is deciphered (and scored), each attempt is cheap regardless of the
+ * size of the ciphertext.
+ */
+#define SEARCH_SAMPLE_LETTERS 256
+
+/**
+ * The number of keys claimed by a thread at once - small enough to balance the threads
+ * (and to stop promptly), yet large enough that claiming is rarely contended.
+ */
+#define SEARCH_CHUNK_KEYS 1024
+
+/**
+ * The default threshold of an n-gram model is this multiple of the mean score of English
+ * under the model (its entropy) - a sample deciphered with the wrong key consists largely
+ * of unseen n-grams, whose score is far greater.
+ */
+#define SEARCH_CONFIDENCE 1.2
+
+// The count given to n-grams absent from the model, as their probability is not zero.
+#define MODEL_FLOOR_COUNT 0.01
+
+/**
+ * This structure holds a language model (see vigenere.h).
+ *
+ * scores[n-gram] is the negative log10-probability of each of the CHAR_SPACE^order n-grams,
+ * whereby the n-gram ABCD is stored at ((A * 26 + B) * 26 + C) * 26 + D.
+ */
+struct vigenere_model {
+  int order; // the length of the n-grams (i.e., 4 = quadgrams).
+  float *scores; // the score of each n-gram.
+  double threshold; // the default score at which a search terminates early (0 = never).
+};
+
+// Returns CHAR_SPACE^order, that is, the number of n-grams of the given order.
+static size_t
+ngram_count(int order) {
+  size_t count = 1;
+
+  for (int order_ctr = 0; order_ctr < order; order_ctr++) count *= CHAR_SPACE;
+  return count;
+}
+
+vigenere_model_t *
+vigenere_model_english(void) {
+  vigenere_model_t *model = (vigenere_model_t *)malloc(sizeof(vigenere_model_t));
+
+  if (model == NULL || (model->scores = (float *)malloc(CHAR_SPACE * sizeof(float))) == NULL) {
+    free(model);
+    return NULL;
+  }
+
+  for (int letter = 0; letter < CHAR_SPACE; letter++) model->scores[letter] = (float)-log10(english_frequencies[letter]);
+
+  model->order = 1;
+  model->threshold = 0;
+  return model;
+}
+
+/**
+ * The contents are parsed twice - first to find the order (the length of the first n-gram),
+ * then once the table has been allocated, to accumulate the counts in place. The counts
+ * are then converted into scores, i.e., -log10(count / total).
+ */
+vigenere_model_t *
+vigenere_model_ngrams(const char *text, size_t len) {
+  vigenere_model_t *model = NULL;
+  double *counts = NULL, total = 0;
+  size_t text_ctr = 0;
+  int order = 0;
+
+  while (text_ctr < len && isalpha((unsigned char)text[text_ctr])) order++, text_ctr++;
+  if (order < 1 || order > 4) return NULL;
+
+  const size_t table_size = ngram_count(order);
+
+  if ((counts = (double *)calloc(table_size, sizeof(double))) == NULL) return NULL;
+
+  for (text_ctr = 0; text_ctr < len;) {
+    size_t index = 0;
+    int length = 0;
+    double count = 0;
+
+    // Blank lines (and carriage returns) are skipped.
+    if (text[text_ctr] == '\n' || text[text_ctr] == '\r') {
+      text_ctr++;
+      continue;
+    }
+
+    for (; text_ctr < len && isalpha((unsigned char)text[text_ctr]); text_ctr++, length++)
+      index = index * CHAR_SPACE + (size_t)(toupper((unsigned char)text[text_ctr]) - ASCII_HIGHER_OFFSET);
+
+    while (text_ctr < len && (text[text_ctr] == ' ' || text[text_ctr] == '\t')) text_ctr++;
+    for (; text_ctr < len && isdigit((unsigned char)text[text_ctr]); text_ctr++) count = count * 10 + (text[text_ctr] - '0');
+
+    // Anything else upon the line (i.e., a differing length, or a missing count) is invalid.
+    if (length != order || count <= 0 || (text_ctr < len && text[text_ctr] != '\n' && text[text_ctr] != '\r')) {
+      free(counts);
+      return NULL;
+    }
+
+    counts[index] += count;
+    total += count;
+  }
+
+  if ((model = (vigenere_model_t *)malloc(sizeof(vigenere_model_t))) == NULL ||
+      (model->scores = (float *)malloc(table_size * sizeof(float))) == NULL) {
+    free(model);
+    free(counts);
+    return NULL;
+  }
+
+  double entropy = 0;
+
+  for (size_t index = 0; index < table_size; index++) {
+    const double probability = (counts[index] > 0 ? counts[index] : MODEL_FLOOR_COUNT) / total;
+
+    model->scores[index] = (float)-log10(probability);
+    if (counts[index] > 0) entropy -= probability * log10(probability);
+  }
+
+  model->order = order;
+  model->threshold = entropy * SEARCH_CONFIDENCE;
+  free(counts);
+  return model;
+}
+
+void
+vigenere_model_free(vigenere_model_t *model) {
+  if (model == NULL) return;
+
+  free(model->scores);
+  free(model);
+}
+
+/**
+ * These structures hold the state of a search, shared between the threads (search_state_t)
+ * and private to each thread (search_worker_t) respectively.
+ *
+ * The keys are numbered 0 to key_total - 1, and claimed SEARCH_CHUNK_KEYS at a time from
+ * next_key - a thread which finishes its keys early therefore simply claims more, so that
+ * no thread idles whilst others have work remaining. stop is set once a candidate reaches
+ * the threshold, whereupon no more keys are claimed.
+ *
+ * Each worker keeps its own best candidates, which are merged once the threads are joined.
+ */
+typedef struct search_state {
+  const vigenere_model_t *model; // the model the deciphered sample is scored by.
+  const vigenere_search_t *search; // the keys to try.
+  unsigned char sample[SEARCH_SAMPLE_LETTERS]; // the letters (0-25) of the prefix.
+  size_t sample_len; // the number of letters within sample.
+  double threshold; // the score at which the search terminates early (0 = never).
+  size_t count; // the number of candidates kept.
+  unsigned long long key_total; // the number of keys.
+  unsigned long long next_key; // the next key to be claimed.
+  int stop; // non-zero once the search should terminate early.
+#ifdef VIGENERE_THREADS
+  pthread_mutex_t lock; // guards next_key and stop.
+#endif
+} search_state_t;
+
+typedef struct search_worker {
+  search_state_t *state;
+  vigenere_candidate_t candidates[VIGENERE_MAX_SEARCH_CANDIDATES]; // the best, from best to worst.
+  size_t candidate_count;
+  size_t tried; // the number of keys tried by this worker.
+} search_worker_t;
+
+// Returns the shift of a key character, as per vigenere_fill_shifts().
+static inline unsigned char
+key_shift(char character) {
+  const int shift = (toupper((unsigned char)character) - ASCII_HIGHER_OFFSET) % CHAR_SPACE;
+  return (unsigned char)((shift + CHAR_SPACE) % CHAR_SPACE);
+}
+
+/**
+ * Claims (up to) SEARCH_CHUNK_KEYS keys, storing the first within first_key. Returns the
+ * number claimed, which is 0 once every key has been claimed (or the search stopped).
+ */
+static size_t
+claim_keys(search_state_t *state, unsigned long long *first_key) {
+  size_t claimed = 0;
+
+#ifdef VIGENERE_THREADS
+  pthread_mutex_lock(&state->lock);
+#endif
+  if (!state->stop && state->next_key < state->key_total) {
+    claimed = state->key_total - state->next_key < SEARCH_CHUNK_KEYS ? (size_t)(state->key_total - state->next_key) : SEARCH_CHUNK_KEYS;
+    *first_key = state->next_key;
+    state->next_key += claimed;
+  }
+#ifdef VIGENERE_THREADS
+  pthread_mutex_unlock(&state->lock);
+#endif
+
+  return claimed;
+}
+
+// Terminates the search, as a candidate has reached the threshold.
+static void
+stop_search(search_state_t *state) {
+#ifdef VIGENERE_THREADS
+  pthread_mutex_lock(&state->lock);
+#endif
+  state->stop = 1;
+#ifdef VIGENERE_THREADS
+  pthread_mutex_unlock(&state->lock);
+#endif
+}
+
+/**
+ * Deciphers the sample using the shifts of a key, and returns its score, that is, the mean
+ * score of its n-grams. The letters are deciphered directly (having been reduced to 0-25
+ * when the sample was taken), hence no classification nor case handling is required.
+ *
+ * As the score of each n-gram is positive, the total only grows - should it exceed that
+ * of bound, the key cannot be ranked, and the remainder of the sample is skipped (whereby
+ * a score greater than bound is returned).
+ */
+static double
+score_key(const search_state_t *state, const unsigned char *shifts, size_t key_len, double bound) {
+  const int order = state->model->order;
+  const float *scores = state->model->scores;
+  const size_t high = ngram_count(order - 1), ngrams = state->sample_len - (size_t)order + 1;
+  const double limit = bound * (double)ngrams;
+  unsigned char plain[SEARCH_SAMPLE_LETTERS];
+  size_t index = 0, key_pos = 0;
+  double total = 0;
+
+  for (size_t sample_ctr = 0; sample_ctr < state->sample_len; sample_ctr++) {
+    int letter = (int)state->sample[sample_ctr] - (int)shifts[key_pos];
+
+    letter += letter < 0 ? CHAR_SPACE : 0;
+    plain[sample_ctr] = (unsigned char)letter;
+    if (++key_pos == key_len) key_pos = 0;
+
+    // The index of the n-gram ending at this letter, from which the first letter is removed.
+    index = index * CHAR_SPACE + (size_t)letter;
+    if (sample_ctr + 1 < (size_t)order) continue;
+
+    total += scores[index];
+    index -= plain[sample_ctr + 1 - (size_t)order] * high;
+
+    if ((sample_ctr & 31) == 31 && total > limit) break;
+  }
+
+  return total / (double)ngrams;
+}
+
+// Inserts the candidate into candidates (from best to worst), discarding the worst should these be full.
+static void
+insert_candidate(vigenere_candidate_t *candidates, size_t *candidate_count, size_t count, const vigenere_candidate_t *candidate) {
+  size_t position = *candidate_count < count ? (*candidate_count)++ : count;
+
+  while (position > 0 && candidates[position - 1].score > candidate->score) {
+    if (position < count) candidates[position] = candidates[position - 1];
+    position--;
+  }
+
+  if (position < count) candidates[position] = *candidate;
+}
+
+/**
+ * Thread entry point for the search - tries each key claimed, until none remain.
+ *
+ * Should keys be NULL, key n is the n-th of every key of A-Z in order of length (A, B, ...
+ * Z, AA, AB, ...). The first key of each claim is decoded from its number, and each
+ * subsequent key obtained by incrementing the last (i.e., AZ -> BA, ZZ -> AAA).
+ */
+static void *
+search_keys(void *arg) {
+  search_worker_t *worker = (search_worker_t *)arg;
+  search_state_t *state = worker->state;
+  const vigenere_search_t *search = state->search;
+  unsigned char shifts[VIGENERE_MAX_PERIOD];
+  unsigned long long first_key = 0;
+  size_t claimed = 0;
+
+  while ((claimed = claim_keys(state, &first_key)) > 0) {
+    vigenere_candidate_t candidate;
+    size_t key_len = 0;
+
+    if (search->keys == NULL) {
+      unsigned long long remainder = first_key, length_keys = CHAR_SPACE;
+
+      for (key_len = 1; remainder >= length_keys; key_len++, length_keys *= CHAR_SPACE) remainder -= length_keys;
+      for (size_t key_ctr = key_len; key_ctr-- > 0; remainder /= CHAR_SPACE) shifts[key_ctr] = (unsigned char)(remainder % CHAR_SPACE);
+    }
+
+    for (size_t claim_ctr = 0; claim_ctr < claimed; claim_ctr++) {
+      const char *key = search->keys != NULL ? search->keys[first_key + claim_ctr] : NULL;
+
+      if (key != NULL) {
+        key_len = strlen(key);
+        if (key_len == 0 || key_len > VIGENERE_MAX_PERIOD) continue;
+        for (size_t key_ctr = 0; key_ctr < key_len; key_ctr++) shifts[key_ctr] = key_shift(key[key_ctr]);
+      } else if (claim_ctr > 0) {
+        size_t key_ctr = key_len;
+
+        while (key_ctr > 0 && ++shifts[key_ctr - 1] == CHAR_SPACE) shifts[--key_ctr] = 0;
+        if (key_ctr == 0) shifts[key_len++] = 0;
+      }
+
+      const double bound = worker->candidate_count == state->count ? worker->candidates[state->count - 1].score : 1e300;
+
+      worker->tried++;
+      candidate.score = score_key(state, shifts, key_len, bound);
+      if (candidate.score >= bound) continue;
+
+      for (size_t key_ctr = 0; key_ctr < key_len; key_ctr++)
+        candidate.key[key_ctr] = key != NULL ? key[key_ctr] : (char)(ASCII_HIGHER_OFFSET + shifts[key_ctr]);
+      candidate.key[key_len] = '\0';
+      candidate.period = key_len;
+      candidate.ioc = 0;
+
+      insert_candidate(worker->candidates, &worker->candidate_count, state->count, &candidate);
+
+      if (state->threshold > 0 && candidate.score <= state->threshold) {
+        stop_search(state);
+        return NULL;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+// Returns the index of coincidence of the sample, deciphered using the key.
+static double
+sample_ioc(const search_state_t *state, const char *key) {
+  const size_t key_len = strlen(key);
+  size_t counts[CHAR_SPACE] = { 0 };
+  double coincidences = 0;
+
+  for (size_t sample_ctr = 0; sample_ctr < state->sample_len; sample_ctr++)
+    counts[(state->sample[sample_ctr] + CHAR_SPACE - key_shift(key[sample_ctr % key_len])) % CHAR_SPACE]++;
+
+  for (int letter = 0; letter < CHAR_SPACE; letter++) coincidences += (double)counts[letter] * ((double)counts[letter] - 1);
+  return coincidences / ((double)state->sample_len * ((double)state->sample_len - 1));
+}
+
+#ifdef VIGENERE_OPENCL
+/**
+ * Searches of at least GPU_MIN_KEYS keys of A-Z (that is, up to six letters or more) are
+ * scored upon a GPU, GPU_SEARCH_KEYS keys per batch (see gpu_search()).
+ *
+ * The GPU scores in single precision, hence its scores may differ from those of score_key()
+ * within the last few digits - every key within GPU_SCORE_TOLERANCE of ranking is therefore
+ * rescored by the host, so that the candidates (and their scores) are exactly those found
+ * upon the processor.
+ */
+#define GPU_MIN_KEYS (16ULL * 1024 * 1024)
+#define GPU_SEARCH_KEYS (1024 * 1024)
+#define GPU_SCORE_TOLERANCE 1e-4
+
+// Submits a batch of key_count keys of key_len letters (from first_key) to the slot. Returns 0 should this fail.
+static int
+gpu_submit_keys(gpu_t *gpu, gpu_slot_t *slot, const search_state_t *state, cl_mem sample, cl_mem scores, 
+                unsigned long long first_key, size_t key_len, size_t key_count) {
+  const cl_uint sample_len = (cl_uint)state->sample_len, order = (cl_uint)state->model->order;
+  const cl_uint ngram_total = (cl_uint)ngram_count(state->model->order), length = (cl_uint)key_len, count = (cl_uint)key_count;
+  const cl_ulong first = (cl_ulong)first_key;
+  const size_t global_size = key_count;
+
+  slot->output = NULL;
+  slot->len = key_count;
+
+  const int submitted = clSetKernelArg(gpu->score, 0, sizeof(cl_mem), &sample) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->score, 1, sizeof(cl_uint), &sample_len) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->score, 2, sizeof(cl_mem), &scores) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->score, 3, sizeof(cl_uint), &order) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->score, 4, sizeof(cl_uint), &ngram_total) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->score, 5, sizeof(cl_ulong), &first) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->score, 6, sizeof(cl_uint), &length) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->score, 7, sizeof(cl_uint), &count) == CL_SUCCESS &&
+                        clSetKernelArg(gpu->score, 8, sizeof(cl_mem), &slot->text) == CL_SUCCESS &&
+                        clEnqueueNDRangeKernel(slot->queue, gpu->score, 1, NULL, &global_size, NULL, 0, NULL, NULL) == CL_SUCCESS &&
+                        clEnqueueReadBuffer(slot->queue, slot->text, CL_FALSE, 0, key_count * sizeof(cl_float), slot->host_text, 
+                                            0, NULL, &slot->done) == CL_SUCCESS &&
+                        clFlush(slot->queue) == CL_SUCCESS;
+
+  if (!submitted) gpu_discard(slot);
+  return submitted;
+}
+
+/**
+ * Ranks a batch of keys scored by the GPU (in order, as search_keys() would), rescoring each 
+ * which may rank. Returns non-zero should a candidate reach the threshold, whereupon the 
+ * search terminates.
+ */
+static int
+gpu_rank_keys(search_worker_t *worker, const float *results, unsigned long long first_key, size_t key_len, size_t key_count) {
+  const search_state_t *state = worker->state;
+  unsigned char shifts[VIGENERE_MAX_SEARCH_LENGTH];
+
+  for (size_t key_ctr = 0; key_ctr < key_count; key_ctr++) {
+    const double bound = worker->candidate_count == state->count ? worker->candidates[state->count - 1].score : 1e300;
+    unsigned long long number = first_key + key_ctr;
+    vigenere_candidate_t candidate;
+
+    worker->tried++;
+    if (results[key_ctr] >= bound * (1 + GPU_SCORE_TOLERANCE)) continue;
+
+    for (size_t shift_ctr = key_len; shift_ctr-- > 0; number /= CHAR_SPACE) shifts[shift_ctr] = (unsigned char)(number % CHAR_SPACE);
+
+    candidate.score = score_key(state, shifts, key_len, bound);
+    if (candidate.score >= bound) continue;
+
+    for (size_t shift_ctr = 0; shift_ctr < key_len; shift_ctr++) candidate.key[shift_ctr] = (char)(ASCII_HIGHER_OFFSET + shifts[shift_ctr]);
+    candidate.key[key_len] = '\0';
+    candidate.period = key_len;
+    candidate.ioc = 0;
+
+    insert_candidate(worker->candidates, &worker->candidate_count, state->count, &candidate);
+    if (state->threshold > 0 && candidate.score <= state->threshold) return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * Tries every key of A-Z (see search_keys()) upon the GPU, a batch of keys per slot - whilst
+ * the device scores one batch, the host ranks the other. The keys are ranked in order, as
+ * a single thread would.
+ *
+ * Returns 0 should there be no device (or should it fail), whereupon the worker is reset
+ * and the processor searches instead.
+ */
+static int
+gpu_search(search_state_t *state, search_worker_t *worker) {
+  const size_t table_size = ngram_count(state->model->order) * sizeof(float);
+  unsigned long long first_keys[GPU_SLOTS];
+  size_t key_lens[GPU_SLOTS];
+  int next_slot = 0, stopped = 0, failed = 0;
+  cl_int error = CL_SUCCESS;
+  gpu_t *gpu = NULL;
+
+  if ((gpu = gpu_acquire()) == NULL) return 0;
+
+  cl_mem sample = clCreateBuffer(gpu->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, state->sample_len, state->sample, &error);
+  cl_mem scores = clCreateBuffer(gpu->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, table_size, state->model->scores, &error);
+
+  failed = sample == NULL || scores == NULL;
+
+  for (unsigned long long key_len = 1, length_keys = CHAR_SPACE; !failed && !stopped && key_len <= state->search->max_length; 
+       key_len++, length_keys *= CHAR_SPACE) {
+    for (unsigned long long first_key = 0; !failed && !stopped && first_key < length_keys; first_key += GPU_SEARCH_KEYS) {
+      gpu_slot_t *slot = &gpu->slots[next_slot];
+      const size_t key_count = length_keys - first_key < GPU_SEARCH_KEYS ? (size_t)(length_keys - first_key) : GPU_SEARCH_KEYS;
+
+      // The slot's previous batch is ranked whilst the other slot's batch is being scored.
+      if (slot->done != NULL) {
+        if (!gpu_complete(slot)) failed = 1;
+        else stopped = gpu_rank_keys(worker, (const float *)slot->host_text, first_keys[next_slot], key_lens[next_slot], slot->len);
+        if (failed || stopped) break;
+      }
+
+      if (!gpu_submit_keys(gpu, slot, state, sample, scores, first_key, (size_t)key_len, key_count)) failed = 1;
+
+      first_keys[next_slot] = first_key;
+      key_lens[next_slot] = (size_t)key_len;
+      next_slot = (next_slot + 1) % GPU_SLOTS;
+    }
+  }
+
+  // The batches still in flight are ranked from the oldest, unless the search has terminated.
+  for (int slot_ctr = 0; slot_ctr < GPU_SLOTS; slot_ctr++, next_slot = (next_slot + 1) % GPU_SLOTS) {
+    gpu_slot_t *slot = &gpu->slots[next_slot];
+
+    if (slot->done == NULL) continue;
+
+    if (failed || stopped) {
+      gpu_discard(slot);
+    } else if (!gpu_complete(slot)) {
+      failed = 1;
+    } else {
+      stopped = gpu_rank_keys(worker, (const float *)slot->host_text, first_keys[next_slot], key_lens[next_slot], slot->len);
+    }
+  }
+
+  if (scores != NULL) clReleaseMemObject(scores);
+  if (sample != NULL) clReleaseMemObject(sample);
+  gpu_release(gpu);
+
+  if (failed) {
+    worker->candidate_count = 0;
+    worker->tried = 0;
+    return 0;
+  }
+
+  return 1;
+}
+#endif
+
+size_t
+vigenere_search(const vigenere_model_t *model, const char *text, size_t len, vigenere_search_t *search,
+                vigenere_candidate_t *candidates, size_t count) {
+  search_worker_t *workers = NULL;
+  search_state_t state;
+  size_t candidate_count = 0;
+  const int threads = search->threads < 1 ? 1 : search->threads > MAX_THREADS ? MAX_THREADS : search->threads;
+
+  memset(&state, 0, sizeof(state));
+  search->tried = 0;
+  if (count > VIGENERE_MAX_SEARCH_CANDIDATES) count = VIGENERE_MAX_SEARCH_CANDIDATES;
+  if (count == 0 || (search->keys == NULL && (search->max_length < 1 || search->max_length > VIGENERE_MAX_SEARCH_LENGTH))) return 0;
+
+  // The sample consists of the first SEARCH_SAMPLE_LETTERS letters, as with the analysis.
+  for (size_t text_ctr = 0; text_ctr < len && state.sample_len < SEARCH_SAMPLE_LETTERS; text_ctr++) {
+    const unsigned char index = (unsigned char)(((unsigned char)text[text_ctr] | 0x20) - ASCII_LOWER_OFFSET);
+
+    state.sample[state.sample_len] = index;
+    state.sample_len += index < CHAR_SPACE;
+  }
+
+  if (state.sample_len < (size_t)model->order + 1) return 0;
+
+  state.model = model;
+  state.search = search;
+  state.threshold = search->threshold > 0 ? search->threshold : model->threshold;
+  state.count = count;
+
+  if (search->keys != NULL) state.key_total = search->key_count;
+  else for (unsigned long long length_keys = CHAR_SPACE, length = 1; length <= search->max_length; length++, length_keys *= CHAR_SPACE)
+    state.key_total += length_keys;
+
+  if ((workers = (search_worker_t *)calloc((size_t)threads, sizeof(search_worker_t))) == NULL) return 0;
+
+#ifdef VIGENERE_THREADS
+  pthread_mutex_init(&state.lock, NULL);
+#endif
+
+  for (int thread_ctr = 0; thread_ctr < threads; thread_ctr++) workers[thread_ctr].state = &state;
+
+  int searched = 0;
+
+#ifdef VIGENERE_OPENCL
+  // Wordlists are searched upon the processor, as each key would otherwise be uploaded as well.
+  if (search->keys == NULL && state.key_total >= GPU_MIN_KEYS) searched = gpu_search(&state, &workers[0]);
+#endif
+
+  if (!searched) run_threads(search_keys, workers, sizeof(search_worker_t), threads);
+
+#ifdef VIGENERE_THREADS
+  pthread_mutex_destroy(&state.lock);
+#endif
+
+  // The best candidates of each worker are merged into the best overall.
+  for (int thread_ctr = 0; thread_ctr < threads; thread_ctr++) {
+    for (size_t candidate_ctr = 0; candidate_ctr < workers[thread_ctr].candidate_count; candidate_ctr++)
+      insert_candidate(candidates, &candidate_count, count, &workers[thread_ctr].candidates[candidate_ctr]);
+    search->tried += workers[thread_ctr].tried;
+  }
+
+  for (size_t candidate_ctr = 0; candidate_ctr < candidate_count; candidate_ctr++)
+    candidates[candidate_ctr].ioc = sample_ioc(&state, candidates[candidate_ctr].key);
+
+  free(workers);
+  return candidate_count;
+}
@@ -1,12 +1,30 @@
 /**
  * Copyright (C) 2023 Ryan Instrell - All rights reserved.
  *
- * usage: ./vigenere [-h] "message" [-m MODE] [-k "KEY"]
+ * usage: ./vigenere [-h] "message" [-m MODE] (-k "KEY" | --key-file FILE | --key-env VAR)
+ *                   [-c CIPHER] [-A ALPHABET] [-i FILE] [-o FILE] [-j N] [-b FORMAT [-R] [-K FILE]]
+ *                   [--autokey | --running-key FILE] [--utf8] [--fold] [--uring | --splice]
+ *                   [--index FILE] [--range A:B] [-r DIR -o DIR] [--serve SOCKET [-K FILE]]
+ *                   [--decompress FORMAT] [--compress FORMAT] [--constant-time]
+ *                   [--histogram FILE [--histogram-sample N]] [--stats]
+ *        ./vigenere [-h] "message" -a [-i FILE] [-p N]
+ *        ./vigenere [-h] "message" -s [-w FILE | -l N] [-q FILE] [-t SCORE] [-i FILE] [-j N]
  */
 
+/**
+* Exposes vmsplice() and F_SETPIPE_SZ upon Linux ("--splice"), which must precede every
+* include in order to take effect.
+*
+* https://man7.org/linux/man-pages/man7/feature_test_macros.7.html
+*/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 /**
 * Provides functions to interact with the i/o streams.
-* those used within this program: printf(), fprintf()
+* those used within this program: printf(), fprintf(), fopen(), fread(),
+* fwrite(), fclose()
 *
 * https://cplusplus.com/reference/cstdio/
 */
@@ -14,7 +32,8 @@
 
 /**
 * Provides functions to interact with strings and arrays.
-* those used within this program: strlen(), strncmp()
+* those used within this program: strlen(), strncmp(), memchr(), memcpy(), memset(),
+* strchr(), strcspn(), strspn()
 *
 * https://cplusplus.com/reference/cstring/
 */
@@ -22,7 +41,8 @@
 
 /**
 * Provides functions to achieve various activities.
-* utilities used within this program: malloc(), EXIT_SUCCESS, EXIT_FAILURE
+* utilities used within this program: atoi(), atof(), exit(), EXIT_SUCCESS, 
+* EXIT_FAILURE
 *
 * https://cplusplus.com/reference/cstdlib/
 */
@@ -30,50 +50,261 @@
 
 /**
 * Provides functions to interact with characters.
-* those used within this program: isalpha(), isupper(),
-* toupper()
+* those used within this program: isdigit()
 *
 * https://cplusplus.com/reference/cctype/
 */
 #include <ctype.h>
 
+/**
+* Provides functions to map files into memory, and to interact with file descriptors.
+* those used within this program: mmap(), munmap(), madvise(), open(), fstat(),
+* ftruncate(), write(), close()
+*
+* Similarly to threads, these are POSIX-only - on Windows, files are always
+* streamed using fread()/fwrite().
+*
+* https://man7.org/linux/man-pages/man2/mmap.2.html
+*/
+#ifndef _WIN32
+#define VIGENERE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+/**
+* Provides vmsplice(), through which the output is handed to a pipe by reference, rather
+* than being copied into it (see splice_all()).
+*
+* https://man7.org/linux/man-pages/man2/vmsplice.2.html
+*/
+#if defined(VIGENERE_MMAP) && defined(__linux__)
+#define VIGENERE_SPLICE
+#include <sys/uio.h>
+#endif
+
+/**
+* Provides the threads and directory traversal of the recursive mode ("-r").
+* those used within this program: pthread_create(), pthread_join(), opendir(), readdir(),
+* closedir(), dirfd(), mkdir(), lstat(), sched_yield()
+*
+* Similarly to mapping, these are POSIX-only - on Windows, "-r" is unavailable.
+*
+* https://man7.org/linux/man-pages/man3/readdir.3.html
+*/
+#ifdef VIGENERE_MMAP
+#define VIGENERE_TREE
+#include <pthread.h>
+#include <dirent.h>
+#include <sched.h>
+#include <stdint.h>
+#endif
+
+/**
+* Provides the Unix domain socket and the event loop of the server ("--serve").
+* those used within this program: socket(), bind(), listen(), accept4(), recv(), send(),
+* epoll_create1(), epoll_ctl(), epoll_wait(), sigaction(), clock_gettime()
+*
+* epoll is Linux-only - on other platforms, "--serve" is unavailable.
+*
+* https://man7.org/linux/man-pages/man7/epoll.7.html
+* https://man7.org/linux/man-pages/man7/unix.7.html
+*/
+#if defined(VIGENERE_MMAP) && defined(__linux__)
+#define VIGENERE_SERVE
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <time.h>
+#endif
+
+/**
+* Provides io_uring (Linux 5.6 onwards), through which many reads and writes are kept in
+* flight at once ("--uring"). The system calls are made directly via syscall(), hence
+* liburing is not required - other platforms (or older headers) simply map or stream.
+* those used within this program: io_uring_setup(), io_uring_enter(), io_uring_register()
+*
+* https://man7.org/linux/man-pages/man7/io_uring.7.html
+*/
+#if defined(VIGENERE_MMAP) && defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define VIGENERE_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <stdint.h>
+#endif
+#endif
+
+/**
+* Provides the codecs of the compressed pipeline ("--decompress", "--compress"), that is,
+* gzip (zlib) and zstd (libzstd). These are only included when compiled with -DVIGENERE_ZLIB
+* (linking -lz) and/or -DVIGENERE_ZSTD (linking -lzstd). As each stage of the pipeline is a 
+* thread, the pipeline is POSIX-only.
+* those used within this program: inflateInit2(), inflate(), inflateReset(), inflateEnd(),
+* deflateInit2(), deflate(), deflateEnd(), ZSTD_createDStream(), ZSTD_decompressStream(),
+* ZSTD_freeDStream(), ZSTD_createCCtx(), ZSTD_compressStream2(), ZSTD_freeCCtx()
+*
+* https://zlib.net/manual.html
+* https://facebook.github.io/zstd/zstd_manual.html
+*/
+#if defined(VIGENERE_MMAP) && (defined(VIGENERE_ZLIB) || defined(VIGENERE_ZSTD))
+#define VIGENERE_CODEC
+#ifdef VIGENERE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef VIGENERE_ZSTD
+#include <zstd.h>
+#endif
+#endif
+
+/**
+* Provides the clocks used by the statistics ("--stats"), alongside the peak memory
+* usage (POSIX only) - these are only included when compiled with -DVIGENERE_STATS.
+* those used within this program: clock_gettime(), timespec_get(), clock(), getrusage()
+*
+* https://en.cppreference.com/w/c/chrono
+* https://man7.org/linux/man-pages/man2/getrusage.2.html
+*/
+#ifdef VIGENERE_STATS
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#endif
+
+/**
+* Provides the cipher itself (libvigenere), that is, the kernels and key state.
+* those used within this program: vigenere_transform(), vigenere_transform_parallel(),
+* vigenere_transform_into(), vigenere_transform_histogram(), vigenere_histogram_ioc(),
+* vigenere_fill_shifts(), vigenere_analysis_init(),
+* vigenere_analysis_update(), vigenere_analysis_rank(), vigenere_model_ngrams(),
+* vigenere_search(), vigenere_count(), vigenere_arena_alloc(), vigenere_arena_release()
+*/
+#include "vigenere.h"
+
 // Constants used repetitively throughout the source code.
 /**
- * Defines the modulo space in which the shifts are performed within.
+ * The number of bytes read from the input stream per iteration when
+ * streaming (i.e., message = "-").
  *
- * This restricts the resulting value within the 0-25 range, this ensuring
- * that the character is alphabetic prior to converting to ASCII.
+ * Rather than holding the entire message in memory, the input is processed
+ * within fixed-size chunks of this length. As such, memory usage remains
+ * constant irrespective of the size of the input.
  */
-#define CHAR_SPACE 26
+#define STREAM_CHUNK_SIZE (64 * 1024)
 
 /**
- * After performing the shifts, this value is used to convert the resulting 
- * value into a valid ASCII, alphabetic character. 
+ * The size of the (static) buffer backing the arena from which every buffer of a
+ * run is allocated (see alloc_buffer()). This holds the stream buffer alongside the
+ * shift table and the like, hence single-threaded streaming never calls malloc().
+ * Larger runs (i.e., a keys file) simply spill over into blocks from the heap.
  */
-#define ASCII_HIGHER_OFFSET 'A'
+#define ARENA_BUFFER_SIZE (STREAM_CHUNK_SIZE + 64 * 1024)
 
 /**
-* 'a' = 'A' ^ 0x20.
-*
-* This is because the 6th bit of A-Z is always equal to 1, 
-* whereas the 6th bit of a-z is always equal to 0. 
-* 
-* Resultantly, if the 6th bit of an ASCII character is XORed
-* with 32 (base 10) / 20 (base 16), this will effectively 
-* invert the character's case. 
-*/
-#define ASCII_LOWER_OFFSET (ASCII_HIGHER_OFFSET ^ 0x20) // 'a'
+ * The number of bytes read from the input stream per thread when streaming with
+ * more than one thread. Each window of input is split between the threads, hence
+ * memory usage remains constant (threads * PARALLEL_CHUNK_SIZE).
+ */
+#define PARALLEL_CHUNK_SIZE (4 * 1024 * 1024)
+
+/**
+ * The number of buffers (chunks) in flight at once via io_uring ("--uring"), and the size 
+ * of each whilst single-threaded - whilst one chunk is transformed, the remainder are being
+ * read or written by the kernel.
+ */
+#define URING_DEPTH 8
+#define URING_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * The capacity requested of the output pipe whilst splicing ("--splice"), such that each
+ * vmsplice() hands over as many pages as possible (at most /proc/sys/fs/pipe-max-size).
+ */
+#define SPLICE_PIPE_SIZE (1024 * 1024)
 
 /**
- * Stores convenient constants to delineate the mode of operation - 
- * that is, encrypt and decrypt.
+ * The interval (in bytes of the message) between the checkpoints of an index ("--index"),
+ * each of which records the number of characters within the alphabet preceding it - a range
+ * ("--range") thus begins by counting at most INDEX_INTERVAL bytes, rather than the whole file.
  *
- * The reason for utilising an enum was because due to the assignment of 
- * integral values to these constants, allowing the easy comparison of the mode.
+ * An index consists of a 12-byte header (INDEX_MAGIC, followed by the interval and the 
+ * alphabet, as 4-byte big-endian integers), followed by each checkpoint (8-byte big-endian).
+ */
+#define INDEX_INTERVAL (64 * 1024)
+#define INDEX_MAGIC "VGIX"
+#define INDEX_HEADER_SIZE 12
+
+/**
+ * The recursive mode ("-r") hands the files to the workers in batches of up to TREE_BATCH_FILES
+ * (whose relative paths fit within TREE_BATCH_PATHS bytes), such that the queue is visited once
+ * per batch rather than once per file. TREE_QUEUE_SIZE batches (a power of two) exist in total,
+ * and each worker transforms its files through a buffer of TREE_BUFFER_SIZE bytes.
+ */
+#define TREE_BATCH_FILES 64
+#define TREE_BATCH_PATHS (16 * 1024)
+#define TREE_QUEUE_SIZE 64
+#define TREE_BUFFER_SIZE (1024 * 1024)
+#define TREE_PATH_MAX 4096
+
+/**
+ * The server ("--serve") holds up to SERVE_CONNECTIONS clients at once, each with an input
+ * and output buffer of SERVE_BUFFER_SIZE bytes - enough for the largest request (a 4-byte 
+ * header, a key ID of up to 255 bytes and a payload of up to 65535 bytes) to be buffered whole.
  *
- * Ex. if(Encrypt) { ... } / if(Decrypt) { ... }
+ * The latency of each request is counted within SERVE_LATENCY_BUCKETS buckets of 
+ * SERVE_LATENCY_WIDTH nanoseconds (the last of which holds every slower request).
+ */
+#define SERVE_CONNECTIONS 64
+#define SERVE_BUFFER_SIZE (128 * 1024)
+#define SERVE_HEADER_SIZE 4
+#define SERVE_RESPONSE_HEADER_SIZE 3
+#define SERVE_LATENCY_BUCKETS 10000
+#define SERVE_LATENCY_WIDTH 10
+
+/**
+ * The compressed pipeline ("--decompress", "--compress") passes PIPELINE_DEPTH blocks between
+ * its stages, each holding up to PIPELINE_BLOCK_SIZE bytes of the decompressed message (or 
+ * threads * PARALLEL_CHUNK_SIZE, should it be transformed using more than one thread). The
+ * compressed data is read and written PIPELINE_IO_SIZE bytes at a time.
+ */
+#define PIPELINE_DEPTH 4
+#define PIPELINE_BLOCK_SIZE (1024 * 1024)
+#define PIPELINE_IO_SIZE (256 * 1024)
+
+/**
+ * Seeks to an offset (beyond 2 GiB) within the input whilst selecting a range ("--range"),
+ * for which off_t is only 32 bits wide upon Windows.
+ */
+#ifdef _WIN32
+#define seek_offset(file, offset) _fseeki64(file, (__int64)(offset), SEEK_SET)
+#else
+#define seek_offset(file, offset) fseeko(file, (off_t)(offset), SEEK_SET)
+#endif
+
+/**
+ * The maximum length of a key ID within the keys file ("-K"), and the number of
+ * prepared shift tables held by the key cache (see lookup_key()).
+ */
+#define MAX_KEY_ID_LEN 64
+#define KEY_CACHE_SIZE 256
+
+/**
+ * The longest key (period) considered whilst analysing ("-a") by default, and the
+ * number of recovered keys printed.
+ */
+#define ANALYSIS_PERIOD 32
+#define ANALYSIS_CANDIDATES 5
+
+/**
+ * The number of bytes of the message read whilst searching ("-s") - as only its first
+ * letters are deciphered by each attempt, the remainder is never read.
  */
-typedef enum modes { Encrypt = 0, Decrypt } modes_t;
+#define SEARCH_SAMPLE_SIZE (64 * 1024)
 
 /**
  * Stores the type of documentation that will be printed to stdout.
@@ -87,6 +318,111 @@ typedef enum modes { Encrypt = 0, Decrypt } modes_t;
  */
 typedef enum docs { Help = 0, Usage } docs_t;
 
+/**
+ * Stores the format of the records read whilst in batch mode ("-b").
+ *
+ * NoBatch = the input is a single message, Lines = newline-delimited records,
+ * Prefixed = each record is preceded by its length (4 bytes, big-endian),
+ * Keyed = newline-delimited records, each preceded by a key ID and a tab.
+ */
+typedef enum batches { NoBatch = 0, Lines, Prefixed, Keyed } batches_t;
+
+/**
+ * Stores the compression format of the input ("--decompress") or output ("--compress").
+ *
+ * NoCodec = uncompressed, Gzip = gzip (or zlib) via zlib, Zstd = zstd via libzstd.
+ */
+typedef enum codecs { NoCodec = 0, Gzip, Zstd } codecs_t;
+
+/**
+ * This structure holds the running key ("--running-key"), that is, the file whose text
+ * follows the key - this is consumed in step with the message, one window at a time,
+ * hence neither is held in its entirety.
+ *
+ * As with the message, a regular file is mapped into memory, whereas otherwise (i.e., a
+ * pipe) it is read into buffer one chunk at a time.
+ */
+typedef struct running_key {
+  FILE *file; // the file being read, or NULL should it be mapped.
+  char *map; // the mapping of the file, or NULL should it be read.
+  size_t map_len; // the length of the mapping.
+  char *buffer; // the chunk of the file most recently read, whilst read.
+  const char *text; // the text currently being consumed (the mapping, or buffer).
+  size_t text_len; // the length of text.
+  size_t text_pos; // the number of characters of text consumed.
+  unsigned char *shifts; // the shifts of the window being transformed (see transform_text()).
+  size_t window_size; // the length of each window, and thus the number of shifts (less the padding).
+} running_key_t;
+
+/**
+ * These structures hold the keys loaded from the keys file ("-K"), alongside the
+ * cache of prepared shift tables (see load_keyring() and lookup_key()).
+ *
+ * Each entry maps a key ID to its key, and records the cache slot holding its
+ * shift table (if any). The cache slots form a doubly-linked list (prev/next) in
+ * order of use, so that the least recently used slot can be evicted.
+ */
+typedef struct key_entry {
+  char *id; // the key ID (i.e., "tenant-42").
+  char *key; // the key itself.
+  int cache_slot; // index of the cache slot holding the shift table, or -1.
+} key_entry_t;
+
+typedef struct key_cache_slot {
+  key_state_t key_state; // the prepared shift table.
+  unsigned char *shifts; // the buffer holding the shifts (reused upon eviction), or NULL.
+  int entry; // index of the entry whose shift table is held.
+  int prev, next; // the more/less recently used slots, or -1.
+} key_cache_slot_t;
+
+typedef struct keyring {
+  vigenere_arena_t *arena; // the arena which the keyring (and its shift tables) are allocated from.
+  char *buffer; // the contents of the keys file, which the entries point into.
+  size_t max_key_len; // the length of the longest key, and thus of every cached shift table.
+  alphabet_t alphabet; // the alphabet of every key ("-A").
+  cipher_t cipher; // the cipher of every key ("-c").
+  key_entry_t *entries; // the keys in order of appearance.
+  size_t entry_count; // number of entries.
+  int *table; // hash table of entry indices (-1 = empty).
+  size_t table_size; // number of slots within the hash table (a power of two).
+  key_cache_slot_t slots[KEY_CACHE_SIZE]; // the cache of prepared shift tables.
+  int slot_count; // number of cache slots in use.
+  int head, tail; // the most/least recently used cache slots.
+  size_t hits, misses; // cache statistics.
+} keyring_t;
+
+/**
+ * Stores the phases timed by the statistics ("--stats"), as an index into stats_t.phases.
+ *
+ * Parse = parse_args(), Keystream = generate_keystream() (and loading the keys file),
+ * Transform = the transformations themselves, Total = the lifetime of the program.
+ * The remainder of Total is that spent reading and writing.
+ */
+typedef enum phases { Parse = 0, Keystream, Transform, Total, PhaseCount } phases_t;
+
+/**
+ * This structure holds the statistics printed by "--stats".
+ *
+ * The key cache statistics are always gathered. The remainder are only gathered when
+ * compiled with -DVIGENERE_STATS - otherwise, the STATS_*() macros expand to nothing,
+ * whereby the hot paths are exactly as they would be without the statistics.
+ */
+typedef struct phase {
+  double wall, cpu; // accumulated wall-clock and CPU time, in seconds.
+  double wall_start, cpu_start; // the start of the current measurement.
+} phase_t;
+
+typedef struct stats {
+  size_t cache_hits, cache_misses; // key cache statistics, whilst in the "keyed" batch mode.
+  size_t requests; // requests served (and their latency percentiles, in nanoseconds), whilst serving.
+  size_t latency_p50, latency_p99, latency_max;
+#ifdef VIGENERE_STATS
+  phase_t phases[PhaseCount]; // the time spent within each phase.
+  size_t bytes; // bytes transformed.
+  size_t alpha; // of which are within the alphabet, and thereby shifted (the remainder are passed through).
+#endif
+} stats_t;
+
 /**
  * This structure holds members that are pertinent to the program.
  *
@@ -105,9 +441,50 @@ typedef enum docs { Help = 0, Usage } docs_t;
 typedef struct config {
   modes_t option; // encrypt/decrypt operation.
   char *message; // plain/ciphertext of variable length. 
-  char *output; // the resulting output from the encryption/decryption.
+  size_t message_len; // length of the message (or current chunk), excluding '\0'.
   char *key; // the initial key passed in by the user.
-  char *keystream; // keystream generated from the supplied key.
+  char *key_path; // file to read the key from, in place of "-k" ("--key-file").
+  char *key_env; // environment variable to read the key from, in place of "-k" ("--key-env").
+  key_state_t key_state; // shift table generated from the key, and the current position.
+  char *input_path; // file to stream the message from (NULL = stdin).
+  char *output_path; // file to stream the output to (NULL = stdout).
+  int threads; // number of threads to transform with ("-j", 1 = default).
+  batches_t batch; // format of the records whilst in batch mode ("-b").
+  int reset_key; // non-zero should the key restart at each record ("-R").
+  char *keys_path; // file containing the key IDs and keys ("-K").
+  keyring_t *keyring; // the keys loaded from keys_path, whilst in the "keyed" batch mode.
+  int stats; // non-zero should statistics be printed upon completion ("--stats").
+  int analyze; // non-zero should the message be analysed to recover its key ("-a").
+  size_t max_period; // the longest key considered whilst analysing ("-p").
+  int search; // non-zero should keys be searched for the one which deciphers the message ("-s").
+  char *wordlist_path; // file containing the keys to try whilst searching ("-w").
+  size_t max_length; // the longest key tried whilst searching every key ("-l").
+  char *model_path; // file containing the n-grams to score the keys with ("-q").
+  double threshold; // the score at which the search terminates early ("-t", 0 = default).
+  stats_t counters; // the statistics printed upon completion ("--stats").
+  vigenere_arena_t arena; // the arena from which every buffer of the run is allocated.
+  alphabet_t alphabet; // the alphabet within which the shifts are performed ("-A", Letters = default).
+  int autokey; // non-zero should the key be followed by the plaintext ("--autokey").
+  char *running_key_path; // file whose text follows the key ("--running-key").
+  running_key_t *running_key; // the running key opened from running_key_path, or NULL.
+  cipher_t cipher; // the cipher of the key ("-c", Vigenere = default).
+  int uring; // non-zero should files be read and written via io_uring ("--uring").
+  int splice; // non-zero should the output be spliced into stdout, should it be a pipe ("--splice").
+  int utf8; // non-zero should the message be validated as UTF-8 ("--utf8").
+  int fold; // non-zero should accented Latin letters be folded to their base letters ("--fold").
+  vigenere_utf8_t utf8_state; // the validation state, carried from one chunk to the next.
+  char *index_path; // file to write the index to, or read it from whilst selecting a range ("--index").
+  FILE *index; // the index being written, or NULL.
+  size_t index_offset, index_count; // the bytes (and characters within the alphabet) indexed thus far.
+  int ranged; // non-zero should only a range of the message be transformed ("--range").
+  size_t range_begin, range_end; // the range of bytes [begin, end) to transform.
+  char *tree_path; // directory whose files are transformed into the directory "-o" ("-r").
+  char *serve_path; // the Unix domain socket to serve requests upon ("--serve").
+  int constant_time; // non-zero should the constant-time kernel be used ("--constant-time").
+  codecs_t decompress, compress; // the formats of the input and output ("--decompress", "--compress").
+  char *histogram_path; // file to write the letter counts of the input and output to ("--histogram").
+  FILE *histogram_file; // the file opened from histogram_path, or NULL.
+  vigenere_histogram_t histogram; // the letter counts of the input and output thus far.
 } config_t; // within parameters, config_t is the type hint used.
 
 /**
@@ -120,14 +497,89 @@ typedef struct config {
 static void 
 exit_print_info(docs_t type) {
   // Multi-line string literals to hold help (help_str) and usage (usage_str) information.
-  const char *usage_str = "usage: ./vigenere [-h] \"message\" [-m MODE] [-k \"KEY\"]\n",
-              *help_str = "\npositional arguments: \n\
+  const char *usage_str = "usage: ./vigenere [-h] \"message\" [-m MODE] (-k \"KEY\" | --key-file FILE | --key-env VAR)\n\
+                  [-c CIPHER] [-A ALPHABET] [-i FILE] [-o FILE] [-j N] [-b FORMAT [-R] [-K FILE]]\n\
+                  [--autokey | --running-key FILE] [--utf8] [--fold] [--uring | --splice]\n\
+                  [--index FILE] [--range A:B] [-r DIR -o DIR] [--serve SOCKET [-K FILE]]\n\
+                  [--decompress FORMAT] [--compress FORMAT] [--constant-time]\n\
+                  [--histogram FILE [--histogram-sample N]] [--stats]\n\
+       ./vigenere [-h] \"message\" -a [-i FILE] [-p N]\n\
+       ./vigenere [-h] \"message\" -s [-w FILE | -l N] [-q FILE] [-t SCORE] [-i FILE] [-j N]\n",
+              *help_str = "\nthe flags may be supplied in any order, before or after the message (\"--\"\n\
+ends the flags, should the message begin with '-').\n\
+\npositional arguments: \n\
       message  specifies the message to encrypt/decrypt (A-Z, a-z).\n\
+               (\"-\" = stream the message from stdin, or from -i FILE) \n\
       -m       encrypt/decrypt the subsequent message. \n\
                (0 = encrypt, 1 = decrypt, 0 = default) \n\
       -k       specifies the keyword to use (variable length, ASCII-only). \n\
+      --key-file\n\
+               reads the keyword from the first line of FILE, in place of -k.\n\
+      --key-env\n\
+               reads the keyword from the environment variable VAR, in place of -k.\n\
+      -a       analyses the (encrypted) message to recover its key, printing the\n\
+               most likely keys (in place of -m and -k).\n\
+      -s       searches for the key of the (encrypted) message, trying each key\n\
+               of -w FILE (one per line), or every key of up to -l N letters.\n\
     \noptional arguments: \n\
-      -h       displays help message and usage information.\n\n";
+      -h       displays help message and usage information.\n\
+      -i       when streaming, reads the message from FILE instead of stdin.\n\
+      -o       when streaming, writes the output to FILE instead of stdout.\n\
+      -r       when streaming, transforms every file within DIR (recursively) into\n\
+               the directory -o, using -j N threads.\n\
+      -j       transforms the message using N threads (1 = default).\n\
+      -c       combines the key and message using CIPHER (vigenere = M + K, the\n\
+               default, beaufort = K - M, variant = M - K, gronsfeld = M + K,\n\
+               whereby the key consists of digits).\n\
+      -A       shifts within ALPHABET (letters = A-Z, the default, alphanumeric\n\
+               = A-Z0-9, printable = ASCII ' ' to '~', bytes = every byte).\n\
+      -b       when streaming, transforms many records (lines = one per line,\n\
+               prefixed = each preceded by its 4-byte, big-endian length,\n\
+               keyed = one per line, each preceded by a key ID and a tab).\n\
+      -R       when in batch mode, restarts the key at the start of each record.\n\
+      -K       when in keyed batch mode, reads the key IDs and keys from FILE\n\
+               (one \"ID KEY\" per line; an empty ID uses the key from -k).\n\
+      --autokey\n\
+               follows the key with the plaintext, rather than repeating it.\n\
+      --running-key\n\
+               follows the key with the text of FILE (its letters, or those\n\
+               within -A), rather than repeating it.\n\
+      --utf8   validates the message as UTF-8, whereby only its ASCII characters\n\
+               are shifted (multibyte characters are passed through).\n\
+      --fold   folds accented Latin letters (i.e., 'é') to their base letters\n\
+               prior to shifting them (implies --utf8).\n\
+      --uring  when streaming from and to files, overlaps the reads, writes and\n\
+               transformation using io_uring (Linux only).\n\
+      --splice when mapping a file to a pipe, hands the transformed pages to it\n\
+               via vmsplice, rather than copying them (Linux only).\n\
+      --index  when streaming, writes an index of the message to FILE (or with\n\
+               --range, reads it), recording the key position every 64 KiB.\n\
+      --range  when streaming from a file, transforms only bytes A to B (B is\n\
+               exclusive, and optional), starting from the nearest indexed key\n\
+               position rather than from the start of the file.\n\
+      --serve  serves requests upon the Unix domain SOCKET until interrupted,\n\
+               each of a mode, key ID (of -K, or empty = -k) and payload.\n\
+      --decompress\n\
+               when streaming, decompresses the input (gzip or zstd) prior to\n\
+               transforming it, each stage running within its own thread.\n\
+      --compress\n\
+               when streaming, compresses the output (gzip or zstd).\n\
+      --constant-time\n\
+               transforms the message without branches or lookup tables upon its\n\
+               characters, so that the time taken does not reveal its letters.\n\
+      --histogram\n\
+               writes the letter counts (and index of coincidence) of the input\n\
+               and output to FILE as JSON, counted whilst transforming.\n\
+      --histogram-sample\n\
+               counts one block (of 4 KiB) in every N, estimating the histogram\n\
+               for a fraction of the cost (1 = every block = default).\n\
+      --stats  prints statistics as JSON to stderr (key cache hits/misses, and\n\
+               when compiled with -DVIGENERE_STATS, bytes, time per phase,\n\
+               allocations and peak memory usage).\n\
+      -p       when analysing, considers keys of up to N characters (32 = default).\n\
+      -q       when searching, scores the keys using the n-grams (i.e., quadgrams)\n\
+               of FILE (one \"NGRAM COUNT\" per line), rather than letter frequencies.\n\
+      -t       when searching, stops at the first key scoring at most SCORE.\n\n";
 
   /**
   * Due to the utilisation of an enum, 
@@ -167,303 +619,3403 @@ exit_print_info(docs_t type) {
   exit(EXIT_FAILURE);
 }
 
+#ifdef VIGENERE_STATS
 /**
- * This function is responsible for performing encryption operations.
- *
- * Notice how only the config struct is passed in as a parameter.
- *
- * Furthemore, the config struct is passed in as a reference, so that
- * its members can be modified (notice use of the '->' notation).
- */
-static void 
-encrypt(config_t *config) {
+* These functions measure the time spent within each phase (see phases_t), using a
+* monotonic clock for wall-clock time, and clock() for CPU time (of every thread).
+*/
+static double
+wall_seconds(void) {
+  struct timespec now;
 
-  /**
-  * As the length of the original message is referred to on multiple
-  * occasions within this function, I deemed it neccessary to assign
-  * this to a constant value of type size_t (simply an unsigned
-  * integer). 
-  * 
-  * By doing this, I can continually refer to this without incurring the
-  * runtime penalty of using strlen() repeatedly.
-  */ 
-  const size_t text_len = strlen(config->message);
+#ifndef _WIN32
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  timespec_get(&now, TIME_UTC);
+#endif
 
-  /**
-  * The resulting output is allocated on the heap accordingly.
-  * 
-  * Notably, this allocates the size of the message + 1, as strlen()
-  * does not include the NULL terminating value ('\0') within the string.
-  */ 
-  char *text_enciphered = (char *)malloc(sizeof(char) * text_len + 1);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
 
-  /**
-  * The encryption is performed on ASCII characters, as this is easily printable, and
-  * is significantly more efficient compared to mapping individual characters
-  * to a table of integer values.
-  * 
-  * Futhermore, C allows arithmetic to be easily performed on ASCII values,
-  * as these are treated as both integers and characters. 
-  */ 
-  for (int enc_ctr = 0; enc_ctr <= text_len; enc_ctr++) {
+static void
+phase_begin(phase_t *phase) {
+  phase->wall_start = wall_seconds();
+  phase->cpu_start = (double)clock() / CLOCKS_PER_SEC;
+}
 
-    /**
-    * This check is performed to preserve any punctuation within the original message.
-    * 
-    * If the character is non-alphabetic, simply keep within the enciphered message.
-    * 
-    * Performed using isalpha() from ctype.h.
-    */ 
-    if (!isalpha(config->message[enc_ctr])) 
-      text_enciphered[enc_ctr] = config->message[enc_ctr];
-    else
-
-      /**
-      * Equivalent calculation:
-      * C[i] = (M[i] + K[i] % 26) + 'A'
-      * 
-      * M[i] is shifted K[i] places (ASCII values), and if C[i] is not within
-      * the alphabetic range (0-25), it will wrap around due to '% 26'.
-      * 
-      * It is also important to note that the Vigenere cipher uses a 26x26 table,
-      * thereby restricting us to the range 0-25.
-      */ 
-      text_enciphered[enc_ctr] =
-        ((toupper(config->message[enc_ctr]) + config->keystream[enc_ctr]) % CHAR_SPACE)
-        
-        /**
-        * + 'A' places the character (uppercase) back within the ASCII character space, as this
-        * would otherwise yield non-printable characters. 'a' would have the same effect, but for
-        * lowercase characters. This helps preserve case.  
-        *
-        * Depending on whether the original value in question was uppercase or lowercase,
-        * the offset's case is inverted.
-        */
-        + (isupper(config->message[enc_ctr]) ? ASCII_HIGHER_OFFSET : ASCII_LOWER_OFFSET);
-  }
-
-  config->output = text_enciphered;
-}
-
-// This function is responsible for performing decryption operations.
-static void 
-decrypt(config_t *config) {
+static void
+phase_end(phase_t *phase) {
+  phase->wall += wall_seconds() - phase->wall_start;
+  phase->cpu += (double)clock() / CLOCKS_PER_SEC - phase->cpu_start;
+}
 
-  /**
-  * Once again, as to reduce repetition and, ultimately, repeated computation 
-  * of strlen(), this is instead assigned to a constant value. 
-  */ 
-  const size_t text_len = strlen(config->message);
+// Counts newline-delimited records (see batch_lines()), whose newlines are passed through as they are.
+static void
+stats_records(config_t *config, const char *text, size_t len) {
+  const char *record = text, *end = text + len, *newline = NULL;
 
-  /**
-  * Similarly to encrypt(), space is allocated on the heap to support the length of 
-  * the original message - notably inclusive of the NULL terminator by adding 1
-  * to text_len.
-  */ 
-  char *text_deciphered = (char *)malloc(sizeof(char) * text_len + 1);
+  config->counters.bytes += len;
+  while ((newline = (const char *)memchr(record, '\n', (size_t)(end - record))) != NULL) {
+    config->counters.alpha += vigenere_count_alphabet(record, (size_t)(newline - record), config->alphabet);
+    record = newline + 1;
+  }
 
-  for (int dec_ctr = 0; dec_ctr <= text_len; dec_ctr++) {
+  config->counters.alpha += vigenere_count_alphabet(record, (size_t)(end - record), config->alphabet);
+}
 
-    /**
-    * Similarly, a check using isalpha() is performed to preserve any
-    * punctuation within the original message.
-    */
-    if (!isalpha(config->message[dec_ctr])) 
-      text_deciphered[dec_ctr] = config->message[dec_ctr];
-    else
+/**
+* STATS_BEGIN()/STATS_END() time a phase, and STATS_TRANSFORMED() counts the bytes (and the
+* symbols of the alphabet, "-A") about to be transformed. The symbols are counted within the
+* input, prior to the transformation being timed - as the transformation is in place, and the
+* output of an extended alphabet need not remain within it (i.e., a letter may become a digit).
+* STATS_RECORDS() does the same for newline-delimited records.
+*/
+#define STATS_BEGIN(config, phase) phase_begin(&(config)->counters.phases[phase])
+#define STATS_END(config, phase) phase_end(&(config)->counters.phases[phase])
+#define STATS_TRANSFORMED(config, text, len) \
+  ((config)->counters.bytes += (len), \
+   (config)->counters.alpha += vigenere_count_alphabet((text), (len), (config)->alphabet))
+#define STATS_RECORDS(config, text, len) stats_records((config), (text), (len))
+#else
+#define STATS_BEGIN(config, phase) ((void)0)
+#define STATS_END(config, phase) ((void)0)
+#define STATS_TRANSFORMED(config, text, len) ((void)0)
+#define STATS_RECORDS(config, text, len) ((void)0)
+#endif
+
+/**
+* This function prints the statistics ("--stats") to stderr, as a single line of JSON.
+*
+* The allocations are those of the arena (see alloc_buffer()), that is, the blocks allocated
+* once its backing buffer was exhausted. The peak resident set size (the most memory in use
+* at once) is reported by getrusage() in kilobytes on Linux (but bytes on macOS), and is
+* absent on Windows.
+*/
+static void
+print_stats(config_t *config) {
+  const stats_t *counters = &config->counters;
+  const char *separator = "";
+
+  fprintf(stderr, "{");
+
+  if (config->batch == Keyed || (config->serve_path != NULL && config->keyring != NULL)) {
+    fprintf(stderr, "\"cache_hits\":%zu,\"cache_misses\":%zu", counters->cache_hits, counters->cache_misses);
+    separator = ",";
+  }
+
+  if (config->serve_path != NULL) {
+    fprintf(stderr, "%s\"requests\":%zu,\"latency_ns\":{\"p50\":%zu,\"p99\":%zu,\"max\":%zu}", separator, 
+            counters->requests, counters->latency_p50, counters->latency_p99, counters->latency_max);
+    separator = ",";
+  }
+
+#ifdef VIGENERE_STATS
+  const char *phase_names[PhaseCount] = { "parse", "keystream", "transform", "total" };
+
+  STATS_END(config, Total);
+  fprintf(stderr, "%s\"bytes\":%zu,\"alpha\":%zu,\"passthrough\":%zu", separator, 
+          counters->bytes, counters->alpha, counters->bytes - counters->alpha);
+
+  for (int phase_ctr = 0; phase_ctr < PhaseCount; phase_ctr++)
+    fprintf(stderr, ",\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", phase_names[phase_ctr], 
+            counters->phases[phase_ctr].wall * 1e3, counters->phases[phase_ctr].cpu * 1e3);
+
+  size_t allocations = 0, allocated = 0;
+
+  for (const vigenere_arena_block_t *block = config->arena.first; block != NULL; block = block->next) {
+    allocations += block->owned;
+    allocated += block->owned ? block->capacity : 0;
+  }
+
+  fprintf(stderr, ",\"allocations\":%zu,\"allocated_bytes\":%zu", allocations, allocated);
+
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) fprintf(stderr, ",\"peak_rss_kb\":%ld", (long)usage.ru_maxrss);
+#endif
+#endif
 
-      /**
-      * The calculation is slightly different to encrypt(), whereby we must now
-      * subtract instead of add.
-      *
-      * Equivalent calculation:
-      * M[i] = ((C[i] - K[i] + 26) % 26) + 'A'
-      *
-      * In addition, we add 26 to the result of C[i] - K[i] should this be
-      * a non-positive number.
-      */
-      text_deciphered[dec_ctr] = 
-        ((toupper(config->message[dec_ctr]) - config->keystream[dec_ctr]) + CHAR_SPACE) % CHAR_SPACE
-        // Similarly to encryption, 'A'/'a' is added to convert the value to an alphabetic ASCII value. 
-        + (isupper(config->message[dec_ctr]) ? ASCII_HIGHER_OFFSET : ASCII_LOWER_OFFSET);
+  (void)separator;
+  fprintf(stderr, "}\n");
+}
+
+/**
+* This function allocates size bytes from the arena, exiting should this fail (whereby
+* description names the buffer, i.e., "the shift table").
+*
+* Every buffer of a run (the shift table, the stream buffer, the keyring, ...) is allocated
+* from config->arena, and released together upon completion - none are freed individually.
+* As the arena is backed by a buffer of ARENA_BUFFER_SIZE bytes, a run which requires
+* no more than this never calls malloc().
+*/
+static void *
+alloc_buffer(vigenere_arena_t *arena, size_t size, const char *description) {
+  void *buffer = vigenere_arena_alloc(arena, size);
+
+  if (buffer == NULL) {
+    fprintf(stderr, "error: unable to allocate %s.\n", description);
+    exit(EXIT_FAILURE);
   }
 
-  config->output = text_deciphered;
+  return buffer;
+}
+
+/**
+* This function fills shifts for the key (see vigenere_fill_shifts()), as per the alphabet
+* and cipher - exiting should a Gronsfeld key consist of anything other than digits.
+*/
+static void
+fill_key_shifts(const char *key, size_t key_len, alphabet_t alphabet, cipher_t cipher, unsigned char *shifts) {
+  if (cipher != Gronsfeld) vigenere_fill_shifts_alphabet(key, key_len, alphabet, shifts);
+  else if (vigenere_fill_gronsfeld_shifts(key, key_len, shifts) != 0) {
+    fprintf(stderr, "error: a Gronsfeld key must consist of digits (0-9).\n");
+    exit(EXIT_FAILURE);
+  }
 }
 
 /**
-* This function generates a keystream, given a user-supplied key.
+* This function generates the shift table, given a user-supplied key.
 * 
-* Following generation of the keystream, this will set the keystream
-* member of the config struct - this is why the config struct is passed
-* as a reference in the function's parameters.
+* Rather than materialising a keystream the length of the message (i.e., KEYKE YKEYK),
+* only key_len shifts are stored. encrypt()/decrypt() then select the shift for each 
+* alphabetic character using config->key_pos, which wraps around at key_len.
+*
+* As a result, the keystream requires no allocation proportional to the message, nor
+* an additional pass over it. This is only performed once, even whilst streaming.
 */
 static void 
 generate_keystream(config_t *config) {
 
+  // The length of the supplied key (i.e. KEY = 3) determines the size of the table.
+  const size_t key_len = strlen(config->key);
+
   /**
-  * To generate a keystream, both the lengths of the supplied key (i.e. KEY = 3)
-  * and supplied text must be assigned to constant values using strlen().
+  * Pre-allocate space (from the arena) to support a shift for each character of the key,
+  * in addition to the repeated shifts read by the vectorised kernels.
   */
-  const size_t key_len = strlen(config->key),
-              text_len = strlen(config->message);
-              
-  // Pre-allocate space on the heap to support the keystream of the text's length.
-  char *new_keystream = (char *)malloc(sizeof(char) * text_len + 1); // length + 1 to include NULL terminator value ('\0').
-  
+  unsigned char *new_shifts = (unsigned char *)alloc_buffer(&config->arena, sizeof(unsigned char) * (key_len + KEY_RING_PADDING), 
+                                                           "the shift table");
+
+  fill_key_shifts(config->key, key_len, config->alphabet, config->cipher, new_shifts);
+
+  config->key_state.shifts = new_shifts;
+  config->key_state.key_len = key_len;
+  config->key_state.key_pos = 0;
+  config->key_state.alphabet = config->alphabet;
+  config->key_state.cipher = config->cipher;
+
   /**
-  * key_offset is used to support the inclusion of spaces or other non-alphabetic characters,
-  *
-  * In essence, if M[i] is non-alphabetic, key must remain contiguous and not skip by one.
-  * 
-  * key_offset is, therefore, taken away so that the keystream remains consistent.
+  * An autokey is followed by the plaintext, rather than repeating. The shifts therefore
+  * seed a ring of the next key_len shifts, which the plaintext progressively replaces.
   */
-  int key_ctr = 0, key_offset = 0;
-  
-  for (key_ctr = 0; key_ctr <= text_len && config->message[key_ctr] != '\0'; key_ctr++) {
-    if (!isalpha(config->message[key_ctr])) {
-
-      /**
-      * If M[i] is non-alphabetic, key_offset is incremented.
-      *
-      * Following this, i is substracted by key_offset so that K[i] can 
-      * continue contiguously.
-      */
-      new_keystream[key_ctr] = ' ';
-      key_offset += 1;
-
-    /**
-    * If the key length =/= message length, we require the key to fully pad the message.
-    * 
-    * To wrap the key (i.e., "KEY") around once the length has been reached, a
-    * modulo operation is performed on its index.
-    *
-    * ex.
-    * Message: HELLO WORLD
-    * Key: KEY
-    * Keystream: KEYKE YKEYK
-    */
-    } else new_keystream[key_ctr] = toupper(config->key[(key_ctr - key_offset) % key_len]);
+  if (config->autokey) {
+    config->key_state.autokey = (unsigned char *)alloc_buffer(&config->arena, key_len, "the autokey");
+    memcpy(config->key_state.autokey, new_shifts, key_len);
   }
-
-  config->keystream = new_keystream;
 }
 
 /**
-* This function builds the config structure.
+* This function opens the streams that the message is read from and written to,
+* that is, the files specified via "-i"/"-o", or otherwise stdin/stdout.
 *
-* This accepts the parameters option, message and key,
-* and creates a config struct containing these members
-* accordingly.
+* Files are opened in binary mode ("rb"/"wb"), so that no newline translation
+* is performed on platforms such as Windows.
 *
-* As per Separation of Concerns (SoC), it was deemed neccessary to divide
-* construction of the config structure from the application logic 
-* (i.e., within the main() function). 
+* https://cplusplus.com/reference/cstdio/fopen/
 */
-static config_t
-build_config(int option, char *message, char *key) {
-  config_t config;
+static void
+open_streams(const config_t *config, FILE **input, FILE **output) {
+  if (config->input_path != NULL && (*input = fopen(config->input_path, "rb")) == NULL) {
+    fprintf(stderr, "error: unable to open '%s' for reading.\n", config->input_path);
+    exit(EXIT_FAILURE);
+  }
 
-  // Modify members to the values passed in the function parameters.
-  config.option = option;
-  config.message = message;
-  config.key = key;
+  if (config->output_path != NULL && (*output = fopen(config->output_path, "wb")) == NULL) {
+    fprintf(stderr, "error: unable to open '%s' for writing.\n", config->output_path);
+    exit(EXIT_FAILURE);
+  }
+}
 
-  return config;
+/**
+* This function closes the streams opened by open_streams() (stdin/stdout are
+* flushed, but left open), having first checked that the input was read in its
+* entirety.
+*/
+static void
+close_streams(FILE *input, FILE *output) {
+  if (ferror(input)) {
+    fprintf(stderr, "error: unable to read the input.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (input != stdin) fclose(input);
+  if ((output != stdout ? fclose(output) : fflush(output)) != 0) {
+    fprintf(stderr, "error: unable to write the output.\n");
+    exit(EXIT_FAILURE);
+  }
 }
 
+// Writes len bytes of buf to output, exiting should this fail.
+static void
+write_output(const char *buf, size_t len, FILE *output) {
+  if (fwrite(buf, sizeof(char), len, output) != len) {
+    fprintf(stderr, "error: unable to write the output.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+#ifdef VIGENERE_MMAP
+
 /**
-* This function parses the command-line arguments passed in by the
-* user.
-*
-* In C, command-line arguments are accessible using argv, which together 
-* with argc, are passed into this function to parse into a config structure.
-*
-* There are alternative means to parsing command-line arguments, including getopt
-* (from unistd.h) and argp (argp.h). However, as these are part of the POSIX and
-* GNU C libraries, cross-platform compatibility is affected.
+* This function writes the entirety of buf to the file descriptor fd, as write()
+* may write fewer bytes than requested (or be interrupted by a signal).
 *
-* Resultantly, this is performed manually. As I have opted to make the command-line
-* arguments positional, these are easier to evaluate using the likes of strncmp (
-* note: NOT strcmp due to the lack of bounds checking).
-* 
-* https://www.gnu.org/software/libc/manual/html_node/Program-Arguments.html
+* Returns 0 upon success, otherwise -1.
 */
-static config_t 
-parse_args(int argc, char **argv) {
+static int
+write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    const ssize_t written = write(fd, buf, len);
 
-  // Declares two strings which will be assigned to values passed in. 
-  char *key, *message;
-  modes_t option = Encrypt; // The default mode of operation is to encrypt.
-  config_t config; // An instance of the config structure.
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return -1;
 
-  /**
-  * Check to identify if the number of arguments supplied (via argc)
-  * are expected. For example, here, if no arguments are supplied,
-  * the usage information is printed.
-  */
-  if (argc < 2) exit_print_info(Usage);
-  
-  // The first positional arguments either denotes help ("-h") or the message itself.
-  if (argc > 1 && strncmp(argv[1], "-h", strlen(argv[1])) == 0) 
-    exit_print_info(Help);
-  else if (strncmp(argv[1], "\0", strlen(argv[1])) == 0) // Check for empty entries. 
-    exit_print_info(Usage);
-  else message = argv[1];
-
-  // "-m" denotes the mode of operation (that is, encrypt or decrypt).
-  if (argc > 3 && strncmp(argv[2], "-m", strlen(argv[2])) == 0)
-    if (isdigit(argv[3][0]))
-      option = (int)argv[3][0] % 2; // Convert to binary value to support enumeration.
-    else exit_print_info(Usage);
-  else exit_print_info(Usage);
-  
-  // "-k" denotes the key - followed by a string expected to assume the key value.
-  if (argc > 5 && strncmp(argv[4], "-k", strlen(argv[4])) == 0) 
-    key = argv[5];
-  else exit_print_info(Usage);
+    buf += written;
+    len -= (size_t)written;
+  }
 
-  return build_config(option, message, key); 
+  return 0;
 }
 
+#endif
+
+#ifdef VIGENERE_SPLICE
+
 /**
-* The main entry point of the program.
-* 
-* Here, argc and argv are passed in as arguments, allowing
-* users to supply command-line arguments in addition to the compiled
-* file. i.e., ./vigenere -h 
+* This function determines whether the output (fd) is to be spliced into ("--splice"), that
+* is, whether it is a pipe - in which case, its capacity is raised to SPLICE_PIPE_SIZE (should
+* this fail, the default capacity is simply retained).
+*/
+static int
+splice_output(const config_t *config, int fd) {
+  struct stat output_stat;
+
+  if (!config->splice || fstat(fd, &output_stat) != 0 || !S_ISFIFO(output_stat.st_mode)) return 0;
+
+  fcntl(fd, F_SETPIPE_SZ, SPLICE_PIPE_SIZE);
+  return 1;
+}
+
+/**
+* This function splices the entirety of buf into the pipe fd, which then references the
+* pages of buf, as opposed to a copy of them (see write_all()). As the pipe may be read
+* at any point afterwards, buf must never be modified again - although it may be unmapped,
+* as the pipe holds its own reference to each page.
 *
-* This function was written with Separation of Concerns (SoC) in mind,
-* with the main function containing as little application logic as 
-* needed to function. All other logic is encapsulated within other
-* functions.
+* Returns 0 upon success, otherwise -1.
 */
-int 
-main(int argc, char **argv) {
+static int
+splice_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    struct iovec iov = { (void *)buf, len };
+    const ssize_t spliced = vmsplice(fd, &iov, 1, 0);
 
-  // Passing the command-line arguments into parse_args for further processing.
-  config_t config = parse_args(argc, argv);
+    if (spliced < 0 && errno == EINTR) continue;
+    if (spliced <= 0) return -1;
 
-  /**
-  * The config structure is passed in to generate_keystream()
-  * as a reference (pass by reference). This allows us, within
-  * generate_keystream(), to easily modify the individual
-  * members of the config struct.
-  *
-  * This is passed in using the & notation.
-  */
-  generate_keystream(&config);
-  
-  /**
-  * As Encrypt and Decrypt are enum constants, these are
-  * easily comparable.
-  */
-  if (config.option == Encrypt)
-    encrypt(&config);
-  else decrypt(&config);
+    buf += spliced;
+    len -= (size_t)spliced;
+  }
+
+  return 0;
+}
+
+#endif
+
+/**
+* This function opens the running key ("--running-key"), mapping it into memory should it
+* be a regular file (see map_message()), and otherwise reading it one chunk at a time.
+*/
+static void
+open_running_key(config_t *config) {
+  running_key_t *running_key = (running_key_t *)alloc_buffer(&config->arena, sizeof(running_key_t), "the running key");
 
-  // Print the resulting output to stdout.
-  printf("%s\n", config.output);
+  memset(running_key, 0, sizeof(*running_key));
+
+  if ((running_key->file = fopen(config->running_key_path, "rb")) == NULL) {
+    fprintf(stderr, "error: unable to open '%s' for reading.\n", config->running_key_path);
+    exit(EXIT_FAILURE);
+  }
+
+#ifdef VIGENERE_MMAP
+  struct stat key_stat;
+
+  if (fstat(fileno(running_key->file), &key_stat) == 0 && S_ISREG(key_stat.st_mode) && key_stat.st_size > 0) {
+    char *map = (char *)mmap(NULL, (size_t)key_stat.st_size, PROT_READ, MAP_PRIVATE, fileno(running_key->file), 0);
+
+    if (map != MAP_FAILED) {
+      madvise(map, (size_t)key_stat.st_size, MADV_SEQUENTIAL);
+      running_key->map = map;
+      running_key->map_len = (size_t)key_stat.st_size;
+      running_key->text = map;
+      running_key->text_len = running_key->map_len;
+
+      fclose(running_key->file);
+      running_key->file = NULL;
+    }
+  }
+#endif
+
+  if (running_key->file != NULL)
+    running_key->buffer = (char *)alloc_buffer(&config->arena, sizeof(char) * STREAM_CHUNK_SIZE, "the running key");
+
+  // Each window holds as many shifts as it does characters (at most), followed by the padding.
+  running_key->window_size = config->threads > 1 ? (size_t)config->threads * PARALLEL_CHUNK_SIZE : STREAM_CHUNK_SIZE;
+  running_key->shifts = (unsigned char *)alloc_buffer(&config->arena, running_key->window_size + KEY_RING_PADDING, 
+                                                      "the running key");
+  config->running_key = running_key;
+}
+
+// Closes the running key opened by open_running_key() (its buffers belong to the arena).
+static void
+close_running_key(config_t *config) {
+  running_key_t *running_key = config->running_key;
+
+  if (running_key == NULL) return;
+
+#ifdef VIGENERE_MMAP
+  if (running_key->map != NULL) munmap(running_key->map, running_key->map_len);
+#endif
+  if (running_key->file != NULL) fclose(running_key->file);
+  config->running_key = NULL;
+}
+
+/**
+* This function stores the next count shifts of the running key within shifts - first
+* those of the key itself ("-k", whose position is config->key_state.key_pos), followed 
+* by those of the running key's text, which is read (or mapped) as it is consumed.
+*/
+static void
+fill_running_shifts(config_t *config, unsigned char *shifts, size_t count) {
+  running_key_t *running_key = config->running_key;
+  key_state_t *key_state = &config->key_state;
+  size_t filled = 0;
+
+  while (filled < count && key_state->key_pos < key_state->key_len)
+    shifts[filled++] = key_state->shifts[key_state->key_pos++];
+
+  while (filled < count) {
+    size_t consumed = 0;
+
+    if (running_key->text_pos == running_key->text_len) {
+      const size_t bytes_read = running_key->file != NULL ? 
+                                fread(running_key->buffer, sizeof(char), STREAM_CHUNK_SIZE, running_key->file) : 0;
+
+      if (bytes_read == 0) {
+        fprintf(stderr, "error: the running key is shorter than the message.\n");
+        exit(EXIT_FAILURE);
+      }
+
+      running_key->text = running_key->buffer;
+      running_key->text_len = bytes_read;
+      running_key->text_pos = 0;
+    }
+
+    filled += vigenere_extract_shifts(running_key->text + running_key->text_pos, 
+                                      running_key->text_len - running_key->text_pos, config->alphabet,
+                                      shifts + filled, count - filled, &consumed);
+    running_key->text_pos += consumed;
+  }
+}
+
+/**
+* This function validates the text of the message as UTF-8 ("--utf8"), exiting should it be
+* invalid. The validation state is carried from one call to the next, so that a character 
+* may span chunks, and the offset reported is that within the message as a whole.
+*/
+static void
+validate_text(config_t *config, const char *text, size_t len) {
+  if (vigenere_utf8_validate(&config->utf8_state, text, len) != 0) {
+    fprintf(stderr, "error: invalid UTF-8 at byte %zu of the message.\n", config->utf8_state.offset);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+* This function stores value within bytes bytes of buf (big-endian), as the lengths of the
+* "prefixed" batch mode are (see batch_prefixed()), and load_be() loads it.
+*/
+static void
+store_be(unsigned char *buf, unsigned long long value, size_t bytes) {
+  for (size_t byte_ctr = 0; byte_ctr < bytes; byte_ctr++) 
+    buf[byte_ctr] = (unsigned char)(value >> (8 * (bytes - 1 - byte_ctr)));
+}
+
+static unsigned long long
+load_be(const unsigned char *buf, size_t bytes) {
+  unsigned long long value = 0;
+
+  for (size_t byte_ctr = 0; byte_ctr < bytes; byte_ctr++) value = (value << 8) | buf[byte_ctr];
+  return value;
+}
+
+/**
+* This function opens the index ("--index") for writing, and writes its header.
+*/
+static void
+open_index(config_t *config) {
+  unsigned char header[INDEX_HEADER_SIZE];
+
+  if ((config->index = fopen(config->index_path, "wb")) == NULL) {
+    fprintf(stderr, "error: unable to open '%s' for writing.\n", config->index_path);
+    exit(EXIT_FAILURE);
+  }
+
+  memcpy(header, INDEX_MAGIC, 4);
+  store_be(header + 4, INDEX_INTERVAL, 4);
+  store_be(header + 8, (unsigned long long)config->alphabet, 4);
+  if (fwrite(header, 1, sizeof(header), config->index) != sizeof(header)) {
+    fprintf(stderr, "error: unable to write the index.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+* This function indexes the next len bytes of the message (text), writing a checkpoint
+* (that is, the number of characters within the alphabet thus far) at every multiple of
+* INDEX_INTERVAL - the ciphertext holds these characters at the same offsets as the
+* plaintext, hence the index is of both.
+*/
+static void
+index_text(config_t *config, const char *text, size_t len) {
+  while (len > 0) {
+    const size_t to_checkpoint = INDEX_INTERVAL - config->index_offset % INDEX_INTERVAL,
+                 span = len < to_checkpoint ? len : to_checkpoint;
+
+    config->index_count += vigenere_count_alphabet(text, span, config->alphabet);
+    config->index_offset += span;
+    text += span;
+    len -= span;
+
+    if (config->index_offset % INDEX_INTERVAL == 0) {
+      unsigned char checkpoint[8];
+
+      store_be(checkpoint, config->index_count, sizeof(checkpoint));
+      if (fwrite(checkpoint, 1, sizeof(checkpoint), config->index) != sizeof(checkpoint)) {
+        fprintf(stderr, "error: unable to write the index.\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+}
+
+// Closes the index (if any), exiting should it not have been written in its entirety.
+static void
+close_index(config_t *config) {
+  if (config->index != NULL && fclose(config->index) != 0) {
+    fprintf(stderr, "error: unable to write the index.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Exits should the message end part of the way through a UTF-8 character.
+static void
+finish_text(const config_t *config) {
+  if (config->utf8 && vigenere_utf8_finish(&config->utf8_state) != 0) {
+    fprintf(stderr, "error: the message ends within a UTF-8 character.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+* This function opens the file the histogram ("--histogram") is written to once the
+* message has been transformed - prior to transforming it, so that an unwritable path
+* is reported before any of the output is written.
+*/
+static void
+open_histogram(config_t *config) {
+  if ((config->histogram_file = fopen(config->histogram_path, "w")) == NULL) {
+    fprintf(stderr, "error: unable to open '%s' for writing.\n", config->histogram_path);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+* This function writes the letter counts of the input and output ("--histogram") as a single
+* line of JSON, alongside the index of coincidence of each - that of English plaintext is
+* ~0.066, whereas that of the ciphertext approaches 1/26 (~0.038) as the key lengthens. The
+* sample ("--histogram-sample") and the characters counted precede these, as the counts are
+* only those of the blocks sampled.
+*/
+static void
+write_histogram(config_t *config) {
+  const unsigned long long *counts[2] = { config->histogram.input, config->histogram.output };
+  const char *names[2] = { "input", "output" };
+  FILE *file = config->histogram_file;
+
+  if (file == NULL) return;
+
+  fprintf(file, "{\"sample\":%u,\"counted\":%llu,", config->histogram.sample > 1 ? config->histogram.sample : 1,
+          config->histogram.counted);
+
+  for (int side = 0; side < 2; side++) {
+    unsigned long long letters = 0;
+
+    for (int letter = 0; letter < 26; letter++) letters += counts[side][letter];
+    fprintf(file, "%s\"%s\":{\"letters\":%llu,\"ioc\":%.4f,\"counts\":{", side > 0 ? "," : "", names[side], 
+            letters, vigenere_histogram_ioc(counts[side]));
+
+    for (int letter = 0; letter < 26; letter++) fprintf(file, "%s\"%c\":%llu", letter > 0 ? "," : "", 'A' + letter, counts[side][letter]);
+    fprintf(file, "}}");
+  }
+
+  fprintf(file, "}\n");
+  if (fclose(file) != 0) {
+    fprintf(stderr, "error: unable to write the histogram.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+* This function transforms a window of the message (see transform_text()) using the key state,
+* counting its letters should a histogram ("--histogram") be written.
+*/
+static void
+transform_window(config_t *config, const char *input, char *output, size_t len, key_state_t *key_state) {
+  if (config->histogram_file != NULL)
+    vigenere_transform_histogram(input, output, len, key_state, config->option, config->threads, &config->histogram);
+  else vigenere_transform_parallel(input, output, len, key_state, config->option, config->threads);
+}
+
+/**
+* This function transforms len characters of input into output (which may be the same
+* buffer), continuing from config->key_state - this is used by every path that transforms
+* the message as a whole (that is, other than the batch modes).
+*
+* A repeating key (or an autokey) is transformed directly. A running key, however, never
+* repeats - each window of the message is thus transformed using as many shifts of the
+* running key as it has characters within the alphabet, which are read in step with the
+* message. As a result, neither the message nor the running key is held in its entirety.
+*/
+static void
+transform_text(config_t *config, const char *input, char *output, size_t len) {
+  running_key_t *running_key = config->running_key;
+
+  // Folded text is validated prior to being folded (see stream_message()).
+  if (config->utf8 && !config->fold) validate_text(config, input, len);
+  if (config->index != NULL) index_text(config, input, len);
+
+  if (running_key == NULL) {
+    transform_window(config, input, output, len, &config->key_state);
+    return;
+  }
+
+  for (size_t offset = 0; offset < len; offset += running_key->window_size) {
+    const size_t window_len = len - offset < running_key->window_size ? len - offset : running_key->window_size;
+    const size_t count = vigenere_count_alphabet(input + offset, window_len, config->alphabet);
+
+    fill_running_shifts(config, running_key->shifts, count);
+
+    // The window consumes each of its shifts exactly once, ending back at key position 0.
+    key_state_t window_state = { running_key->shifts, count > 0 ? count : 1, 0, config->alphabet, NULL, config->cipher };
+    transform_window(config, input + offset, output + offset, window_len, &window_state);
+  }
+}
+
+/**
+* This function is responsible for transforming a file by mapping it into memory,
+* as opposed to reading it into a buffer (see stream_message()).
+*
+* Should the output also be a file, this is pre-sized using ftruncate() and mapped
+* as well - the kernel then transforms the input mapping directly into the output
+* mapping, without any copies through user-space buffers. Otherwise (i.e., stdout),
+* the input is mapped privately, transformed in place one window at a time, and
+* written out. Each window is released once written, so memory usage remains 
+* constant.
+*
+* madvise() informs the kernel that the mappings are accessed sequentially, so that
+* pages are read ahead (and reclaimed behind) accordingly.
+*
+* Returns 1 should the message have been transformed, or 0 should the input not be
+* a regular file (i.e., a pipe) - in which case, the caller streams it instead.
+*/
+static int
+map_message(config_t *config) {
+#ifdef VIGENERE_MMAP
+  int input_fd = STDIN_FILENO, output_fd = STDOUT_FILENO;
+  struct stat input_stat, output_stat;
+
+  if (config->input_path != NULL && (input_fd = open(config->input_path, O_RDONLY)) < 0) {
+    fprintf(stderr, "error: unable to open '%s' for reading.\n", config->input_path);
+    exit(EXIT_FAILURE);
+  }
+
+  // Pipes, terminals and empty files cannot be mapped, hence these are streamed.
+  if (fstat(input_fd, &input_stat) != 0 || !S_ISREG(input_stat.st_mode) || input_stat.st_size == 0) {
+    if (input_fd != STDIN_FILENO) close(input_fd);
+    return 0;
+  }
+
+  const size_t size = (size_t)input_stat.st_size;
+
+  if (config->output_path != NULL) {
+    if ((output_fd = open(config->output_path, O_RDWR | O_CREAT, 0666)) < 0) {
+      fprintf(stderr, "error: unable to open '%s' for writing.\n", config->output_path);
+      exit(EXIT_FAILURE);
+    }
+
+    if (fstat(output_fd, &output_stat) != 0 || !S_ISREG(output_stat.st_mode)) {
+      close(output_fd);
+      if (input_fd != STDIN_FILENO) close(input_fd);
+      return 0;
+    }
+
+    // Truncating the output would otherwise destroy the input prior to it being read.
+    if (output_stat.st_dev == input_stat.st_dev && output_stat.st_ino == input_stat.st_ino) {
+      fprintf(stderr, "error: the input and output must be different files.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    if (ftruncate(output_fd, (off_t)size) != 0) {
+      fprintf(stderr, "error: unable to resize '%s'.\n", config->output_path);
+      exit(EXIT_FAILURE);
+    }
+
+    char *input_map = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, input_fd, 0),
+         *output_map = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, output_fd, 0);
+
+    if (input_map == MAP_FAILED || output_map == MAP_FAILED) {
+      fprintf(stderr, "error: unable to map the input/output files.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    madvise(input_map, size, MADV_SEQUENTIAL);
+    madvise(output_map, size, MADV_SEQUENTIAL);
+
+    STATS_TRANSFORMED(config, input_map, size);
+    STATS_BEGIN(config, Transform);
+    transform_text(config, input_map, output_map, size);
+    STATS_END(config, Transform);
+
+    munmap(input_map, size);
+    munmap(output_map, size);
+    close(output_fd);
+  } else {
+
+    /**
+    * MAP_PRIVATE allows the mapping to be modified without affecting the file itself
+    * (copy-on-write). Each window is a multiple of the page size, so that its pages 
+    * can be discarded via MADV_DONTNEED once written.
+    *
+    * Should stdout be a pipe ("--splice"), each window is spliced into it instead - as the
+    * window is never modified once transformed, the pipe may safely reference its pages.
+    */
+    const size_t window_size = (size_t)config->threads * PARALLEL_CHUNK_SIZE;
+#ifdef VIGENERE_SPLICE
+    const int splice = splice_output(config, output_fd);
+#else
+    const int splice = 0;
+#endif
+    char *input_map = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, input_fd, 0);
+
+    if (input_map == MAP_FAILED) {
+      if (input_fd != STDIN_FILENO) close(input_fd);
+      return 0;
+    }
+
+    madvise(input_map, size, MADV_SEQUENTIAL);
+
+    for (size_t offset = 0; offset < size; offset += window_size) {
+      const size_t window_len = size - offset < window_size ? size - offset : window_size;
+
+      STATS_TRANSFORMED(config, input_map + offset, window_len);
+      STATS_BEGIN(config, Transform);
+      transform_text(config, input_map + offset, input_map + offset, window_len);
+      STATS_END(config, Transform);
+
+      if ((splice ? splice_all : write_all)(output_fd, input_map + offset, window_len) != 0) {
+        fprintf(stderr, "error: unable to write the output.\n");
+        exit(EXIT_FAILURE);
+      }
+
+      madvise(input_map + offset, window_len, MADV_DONTNEED);
+    }
+
+    munmap(input_map, size);
+  }
+
+  if (input_fd != STDIN_FILENO) close(input_fd);
+  return 1;
+#else
+  (void)config;
+  return 0;
+#endif
+}
+
+#ifdef VIGENERE_URING
+
+/**
+* The submission and completion queues of an io_uring, which are shared with the kernel
+* (see uring_open()). The kernel consumes submissions from the head of the submission
+* queue, whilst this program consumes completions from the head of the completion queue.
+*/
+typedef struct uring {
+  int fd; // the io_uring itself, or -1.
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ring, *cq_ring; // the mappings of both queues, and their sizes.
+  size_t sq_ring_size, cq_ring_size;
+  unsigned queued; // the submissions queued, although not yet submitted (see uring_wait()).
+} uring_t;
+
+/**
+* This function creates an io_uring of entries submissions, and maps both of its queues
+* into memory.
+*
+* Returns 0 upon success, or -1 should io_uring be unavailable (i.e., an older kernel, or
+* one restricting it via seccomp or kernel.io_uring_disabled).
+*/
+static int
+uring_open(uring_t *ring, unsigned entries) {
+  struct io_uring_params params;
+
+  memset(&params, 0, sizeof(params));
+  ring->queued = 0;
+  if ((ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params)) < 0) return -1;
+
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+                       ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+                       ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes = (struct io_uring_sqe *)mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), 
+                                           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+  if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    close(ring->fd);
+    return -1;
+  }
+
+  // The offsets of each member within the queues are supplied by the kernel.
+  ring->sq_head = (unsigned *)((char *)ring->sq_ring + params.sq_off.head);
+  ring->sq_tail = (unsigned *)((char *)ring->sq_ring + params.sq_off.tail);
+  ring->sq_mask = (unsigned *)((char *)ring->sq_ring + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)((char *)ring->sq_ring + params.sq_off.array);
+  ring->cq_head = (unsigned *)((char *)ring->cq_ring + params.cq_off.head);
+  ring->cq_tail = (unsigned *)((char *)ring->cq_ring + params.cq_off.tail);
+  ring->cq_mask = (unsigned *)((char *)ring->cq_ring + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring + params.cq_off.cqes);
+  return 0;
+}
+
+/**
+* This function queues a read or write (opcode) of len bytes of buf at offset within fd,
+* identified by user_data upon completion. Should the buffers have been registered, 
+* buf_index is the buffer which buf lies within (see uring_message()).
+*
+* The tail is published with release semantics, so that the kernel observes the
+* submission in its entirety.
+*/
+static void
+uring_queue(uring_t *ring, unsigned char opcode, int fd, char *buf, unsigned len, off_t offset, 
+            unsigned buf_index, uint64_t user_data) {
+  const unsigned tail = *ring->sq_tail, index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = len;
+  sqe->off = (uint64_t)offset;
+  sqe->buf_index = (uint16_t)buf_index;
+  sqe->user_data = user_data;
+
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ring->queued++;
+}
+
+/**
+* This function submits any queued submissions, and waits for (and consumes) the next 
+* completion - the user_data of which is returned, alongside its result (res).
+*/
+static uint64_t
+uring_wait(uring_t *ring, int *res) {
+  for (;;) {
+    const unsigned head = *ring->cq_head;
+
+    if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      const uint64_t user_data = cqe->user_data;
+
+      *res = cqe->res;
+      __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+      return user_data;
+    }
+
+    const long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+    if (submitted < 0 && errno != EINTR) {
+      fprintf(stderr, "error: unable to submit to io_uring.\n");
+      exit(EXIT_FAILURE);
+    }
+    if (submitted > 0) ring->queued -= (unsigned)submitted;
+  }
+}
+
+// Unmaps both queues of the io_uring, and closes it.
+static void
+uring_close(uring_t *ring) {
+  munmap(ring->sqes, (*ring->sq_mask + 1) * sizeof(struct io_uring_sqe));
+  munmap(ring->sq_ring, ring->sq_ring_size);
+  munmap(ring->cq_ring, ring->cq_ring_size);
+  close(ring->fd);
+}
+
+#endif
+
+/**
+* This function is responsible for transforming a file via io_uring ("--uring"), whereby
+* the reads, transformation and writes are overlapped - as opposed to mapping the file
+* (see map_message()), where each page is faulted in upon first being transformed.
+*
+* The input is split into chunks, each of which is read into one of URING_DEPTH buffers
+* (registered with the kernel, should the memory lock limit allow it). Chunk i is always
+* read into buffer i % URING_DEPTH, and the chunks are transformed strictly in order, hence
+* config->key_state.key_pos is carried from one chunk to the next as whilst streaming. Once
+* written (at the offset of the chunk), a buffer is reused for the next chunk to be read.
+*
+* As such, up to URING_DEPTH reads and writes are in flight at any time, whilst the CPU
+* transforms whichever chunks have arrived.
+*
+* Returns 1 should the message have been transformed, or 0 should io_uring be unavailable
+* or either file not be regular (i.e., a pipe) - in which case, the caller maps or streams
+* it instead.
+*/
+static int
+uring_message(config_t *config) {
+#ifdef VIGENERE_URING
+  int input_fd = STDIN_FILENO, output_fd;
+  struct stat input_stat, output_stat;
+  uring_t ring;
+
+  // The output is written at the offset of each chunk, hence this must be a file.
+  if (!config->uring || config->output_path == NULL) return 0;
+
+  if (config->input_path != NULL && (input_fd = open(config->input_path, O_RDONLY)) < 0) {
+    fprintf(stderr, "error: unable to open '%s' for reading.\n", config->input_path);
+    exit(EXIT_FAILURE);
+  }
+
+  if (fstat(input_fd, &input_stat) != 0 || !S_ISREG(input_stat.st_mode) || input_stat.st_size == 0 || 
+      (output_fd = open(config->output_path, O_WRONLY | O_CREAT, 0666)) < 0) {
+    if (input_fd != STDIN_FILENO) close(input_fd);
+    return 0;
+  }
+
+  if (fstat(output_fd, &output_stat) != 0 || !S_ISREG(output_stat.st_mode) || uring_open(&ring, URING_DEPTH) != 0) {
+    close(output_fd);
+    if (input_fd != STDIN_FILENO) close(input_fd);
+    return 0;
+  }
+
+  // Truncating the output would otherwise destroy the input prior to it being read.
+  if (output_stat.st_dev == input_stat.st_dev && output_stat.st_ino == input_stat.st_ino) {
+    fprintf(stderr, "error: the input and output must be different files.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (ftruncate(output_fd, input_stat.st_size) != 0) {
+    fprintf(stderr, "error: unable to resize '%s'.\n", config->output_path);
+    exit(EXIT_FAILURE);
+  }
+
+  const size_t size = (size_t)input_stat.st_size,
+               chunk_size = config->threads > 1 ? (size_t)config->threads * PARALLEL_CHUNK_SIZE : URING_CHUNK_SIZE,
+               chunk_count = (size + chunk_size - 1) / chunk_size;
+  char *buffers = (char *)alloc_buffer(&config->arena, URING_DEPTH * chunk_size, "the io_uring buffers");
+
+  /**
+  * Registering the buffers pins them in memory once, rather than upon every read and write 
+  * (IORING_OP_READ_FIXED/IORING_OP_WRITE_FIXED). This counts against RLIMIT_MEMLOCK, hence 
+  * should it fail, the ordinary reads and writes are used instead.
+  */
+  struct iovec iovecs[URING_DEPTH];
+
+  for (size_t buf_ctr = 0; buf_ctr < URING_DEPTH; buf_ctr++) {
+    iovecs[buf_ctr].iov_base = buffers + buf_ctr * chunk_size;
+    iovecs[buf_ctr].iov_len = chunk_size;
+  }
+
+  const int fixed = syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, iovecs, URING_DEPTH) == 0;
+  const unsigned char read_op = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ, 
+                      write_op = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+
+  /**
+  * The progress of each buffer's chunk (done = the bytes read, or written thus far). Each
+  * completion is identified by its buffer, and whether it was a read or a write (the lowest bit).
+  */
+  size_t chunk_of[URING_DEPTH], done[URING_DEPTH];
+  int read_ready[URING_DEPTH];
+  size_t next_read = 0, next_transform = 0, written = 0;
+
+  for (; next_read < chunk_count && next_read < URING_DEPTH; next_read++) {
+    const size_t len = size - next_read * chunk_size < chunk_size ? size - next_read * chunk_size : chunk_size;
+
+    chunk_of[next_read] = next_read;
+    done[next_read] = 0;
+    read_ready[next_read] = 0;
+    uring_queue(&ring, read_op, input_fd, buffers + next_read * chunk_size, (unsigned)len, 
+                (off_t)(next_read * chunk_size), (unsigned)next_read, next_read << 1);
+  }
+
+  while (written < chunk_count) {
+    int res;
+    const uint64_t user_data = uring_wait(&ring, &res);
+    const size_t buf_ctr = (size_t)(user_data >> 1), chunk = chunk_of[buf_ctr],
+                 offset = chunk * chunk_size, len = size - offset < chunk_size ? size - offset : chunk_size;
+    char *buf = buffers + buf_ctr * chunk_size;
+
+    if (res < 0 || (res == 0 && done[buf_ctr] < len)) {
+      fprintf(stderr, "error: unable to %s the message.\n", user_data & 1 ? "write" : "read");
+      exit(EXIT_FAILURE);
+    }
+
+    // Reads and writes may complete short of their length, whereby the remainder is resubmitted.
+    done[buf_ctr] += (size_t)res;
+    if (done[buf_ctr] < len) {
+      uring_queue(&ring, user_data & 1 ? write_op : read_op, user_data & 1 ? output_fd : input_fd, 
+                  buf + done[buf_ctr], (unsigned)(len - done[buf_ctr]), (off_t)(offset + done[buf_ctr]), 
+                  (unsigned)buf_ctr, user_data);
+      continue;
+    }
+
+    if (user_data & 1) {
+
+      // The buffer has been written, hence is refilled with the next chunk (if any).
+      written++;
+      if (next_read < chunk_count) {
+        const size_t next_offset = next_read * chunk_size;
+
+        chunk_of[buf_ctr] = next_read++;
+        done[buf_ctr] = 0;
+        read_ready[buf_ctr] = 0;
+        uring_queue(&ring, read_op, input_fd, buf, 
+                    (unsigned)(size - next_offset < chunk_size ? size - next_offset : chunk_size), 
+                    (off_t)next_offset, (unsigned)buf_ctr, buf_ctr << 1);
+      }
+      continue;
+    }
+
+    /**
+    * The chunk has been read - it (and any chunks following it which have also been read)
+    * is transformed once every chunk preceding it has been, and then written.
+    */
+    read_ready[buf_ctr] = 1;
+
+    while (next_transform < chunk_count && read_ready[next_transform % URING_DEPTH] && 
+           chunk_of[next_transform % URING_DEPTH] == next_transform) {
+      const size_t ready = next_transform % URING_DEPTH, ready_offset = next_transform * chunk_size,
+                   ready_len = size - ready_offset < chunk_size ? size - ready_offset : chunk_size;
+      char *ready_buf = buffers + ready * chunk_size;
+
+      STATS_TRANSFORMED(config, ready_buf, ready_len);
+      STATS_BEGIN(config, Transform);
+      transform_text(config, ready_buf, ready_buf, ready_len);
+      STATS_END(config, Transform);
+
+      read_ready[ready] = 0;
+      done[ready] = 0;
+      uring_queue(&ring, write_op, output_fd, ready_buf, (unsigned)ready_len, (off_t)ready_offset, 
+                  (unsigned)ready, (ready << 1) | 1);
+      next_transform++;
+    }
+  }
+
+  uring_close(&ring);
+  close(output_fd);
+  if (input_fd != STDIN_FILENO) close(input_fd);
+  return 1;
+#else
+  (void)config;
+  return 0;
+#endif
+}
+
+/**
+* This function is responsible for streaming the message from stdin (or a file)
+* to stdout (or a file), as opposed to reading the message from argv.
+*
+* The input is processed within fixed-size chunks (STREAM_CHUNK_SIZE, or
+* PARALLEL_CHUNK_SIZE per thread). As a single buffer is allocated once, and each
+* chunk is transformed in place, memory usage is constant regardless of the size 
+* of the input.
+*
+* As config->key_state.key_pos is carried from one chunk to the next, the resulting output
+* is identical to that of processing the entire message at once.
+*
+* Folding ("--fold") shortens the text, and may only fold whole characters - hence a 
+* character split by the end of a chunk is carried over to the start of the next, and the
+* text is validated, folded and then transformed.
+*/
+static void
+stream_message(config_t *config) {
+  FILE *input = stdin, *output = stdout;
+  size_t bytes_read = 0, carry = 0;
+
+  open_streams(config, &input, &output);
+
+  // The chunk buffer is allocated once, and reused for every chunk.
+  const size_t chunk_size = config->threads > 1 ? (size_t)config->threads * PARALLEL_CHUNK_SIZE : STREAM_CHUNK_SIZE;
+  config->message = (char *)alloc_buffer(&config->arena, sizeof(char) * chunk_size, "the stream buffer");
+
+  /**
+  * fread() returns the number of bytes actually read, which is less than
+  * chunk_size for the final chunk, and 0 once the end of the stream
+  * has been reached.
+  *
+  * https://cplusplus.com/reference/cstdio/fread/
+  */
+  while ((bytes_read = fread(config->message + carry, sizeof(char), chunk_size - carry, input)) > 0 || carry > 0) {
+    const size_t chunk_len = carry + bytes_read;
+    const int at_end = bytes_read < chunk_size - carry;
+
+    config->message_len = chunk_len;
+    carry = 0;
+
+    if (config->fold) {
+      const size_t complete = at_end ? chunk_len : vigenere_utf8_boundary(config->message, chunk_len);
+
+      validate_text(config, config->message, complete);
+      carry = chunk_len - complete;
+      config->message_len = vigenere_utf8_fold(config->message, complete);
+    }
+
+    STATS_TRANSFORMED(config, config->message, config->message_len);
+    STATS_BEGIN(config, Transform);
+    transform_text(config, config->message, config->message, config->message_len);
+    STATS_END(config, Transform);
+
+    write_output(config->message, config->message_len, output);
+    memmove(config->message, config->message + chunk_len - carry, carry);
+  }
+
+  close_streams(input, output);
+}
+
+#ifdef VIGENERE_CODEC
+
+/**
+* The stages of the compressed pipeline, each of which runs within its own thread: decoding
+* the input into blocks, transforming each block (in place), and encoding the blocks into the
+* output. The transformation thus never waits upon a read or write, and vice versa.
+*/
+typedef enum stages { DecodeStage = 0, CipherStage, EncodeStage, StageCount } stages_t;
+
+/**
+* A block of the message, passed from one stage to the next. The last block (of which last is
+* non-zero) is shorter than the others, and may be empty - as the end of the input is only
+* known once it has been read.
+*/
+typedef struct pipeline_block {
+  char *data;
+  size_t len;
+  int last;
+} pipeline_block_t;
+
+/**
+* The state of a compressed (or uncompressed) file, that is, the input being decoded or the
+* output being encoded. PIPELINE_IO_SIZE bytes of the compressed data are buffered at a time.
+*
+* in_frame is non-zero whilst part of the way through a gzip member or zstd frame, such that
+* an input ending there is reported as truncated (rather than silently cut short).
+*/
+typedef struct codec_stream {
+  codecs_t format;
+  FILE *file;
+  unsigned char *buffer;
+  int input_end, in_frame;
+#ifdef VIGENERE_ZLIB
+  z_stream zlib;
+#endif
+#ifdef VIGENERE_ZSTD
+  ZSTD_DStream *dstream;
+  ZSTD_CCtx *cctx;
+  ZSTD_inBuffer zstd_input; // the compressed data buffered whilst decoding.
+#endif
+} codec_stream_t;
+
+/**
+* This structure holds the pipeline, whose blocks are connected by bounded queues.
+*
+* completed[stage] counts the blocks finished by each stage - block n (held within
+* blocks[n % PIPELINE_DEPTH]) may be transformed or encoded once the preceding stage has 
+* completed it, and decoded once the encoding stage has completed block n - PIPELINE_DEPTH 
+* (freeing its buffer). As such, the whole pipeline runs at the speed of its slowest stage,
+* whilst at most PIPELINE_DEPTH blocks are ever held in memory.
+*/
+typedef struct pipeline {
+  pipeline_block_t blocks[PIPELINE_DEPTH];
+  size_t block_size;
+  size_t completed[StageCount];
+  pthread_mutex_t lock;
+  pthread_cond_t progress;
+  codec_stream_t decoder, encoder;
+} pipeline_t;
+
+// Waits until the stage may process block n (see pipeline_t), returning the block.
+static pipeline_block_t *
+pipeline_wait(pipeline_t *pipeline, stages_t stage, size_t n) {
+  pthread_mutex_lock(&pipeline->lock);
+
+  while (stage == DecodeStage ? pipeline->completed[EncodeStage] + PIPELINE_DEPTH <= n 
+                              : pipeline->completed[stage - 1] <= n)
+    pthread_cond_wait(&pipeline->progress, &pipeline->lock);
+
+  pthread_mutex_unlock(&pipeline->lock);
+  return &pipeline->blocks[n % PIPELINE_DEPTH];
+}
+
+// Marks the next block of the stage as completed, waking the stages waiting upon it.
+static void
+pipeline_done(pipeline_t *pipeline, stages_t stage) {
+  pthread_mutex_lock(&pipeline->lock);
+  pipeline->completed[stage]++;
+  pthread_cond_broadcast(&pipeline->progress);
+  pthread_mutex_unlock(&pipeline->lock);
+}
+
+// Returns the name of the format, used within the error messages.
+static const char *
+codec_name(codecs_t format) {
+  return format == Gzip ? "gzip" : "zstd";
+}
+
+// Exits should the input be neither a valid nor a complete stream of the format.
+static void
+exit_invalid_input(const codec_stream_t *codec, int truncated) {
+  fprintf(stderr, "error: the input is %s %s data.\n", truncated ? "truncated" : "not valid", codec_name(codec->format));
+  exit(EXIT_FAILURE);
+}
+
+/**
+* This function prepares the decoder (or encoder) of the format, exiting should the format
+* not have been compiled in - encoding uses the default level of each (6 for gzip, 3 for zstd).
+*/
+static void
+open_codec(codec_stream_t *codec, codecs_t format, FILE *file, unsigned char *buffer, int encode) {
+  int compiled = 0, opened = 0;
+
+  memset(codec, 0, sizeof(*codec));
+  codec->format = format;
+  codec->file = file;
+  codec->buffer = buffer;
+  if (format == NoCodec) return;
+
+#ifdef VIGENERE_ZLIB
+  // A window of 15 bits, plus 16 to write a gzip header (or 32 to read either a gzip or zlib header).
+  if (format == Gzip) {
+    compiled = 1;
+    opened = (encode ? deflateInit2(&codec->zlib, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) 
+                     : inflateInit2(&codec->zlib, 15 + 32)) == Z_OK;
+  }
+#endif
+#ifdef VIGENERE_ZSTD
+  if (format == Zstd) {
+    compiled = 1;
+    opened = encode ? (codec->cctx = ZSTD_createCCtx()) != NULL : (codec->dstream = ZSTD_createDStream()) != NULL;
+  }
+#endif
+
+  if (!compiled) {
+    fprintf(stderr, "error: %s is unavailable (compile with %s).\n", codec_name(format), 
+            format == Gzip ? "-DVIGENERE_ZLIB and link -lz" : "-DVIGENERE_ZSTD and link -lzstd");
+    exit(EXIT_FAILURE);
+  }
+
+  if (!opened) {
+    fprintf(stderr, "error: unable to initialise %s.\n", codec_name(format));
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Releases the decoder (or encoder) prepared by open_codec().
+static void
+close_codec(codec_stream_t *codec, int encode) {
+#ifdef VIGENERE_ZLIB
+  if (codec->format == Gzip) {
+    if (encode) deflateEnd(&codec->zlib);
+    else inflateEnd(&codec->zlib);
+  }
+#endif
+#ifdef VIGENERE_ZSTD
+  if (codec->format == Zstd) {
+    ZSTD_freeCCtx(codec->cctx);
+    ZSTD_freeDStream(codec->dstream);
+  }
+#endif
+  (void)codec;
+  (void)encode;
+}
+
+// Reads the next PIPELINE_IO_SIZE bytes (at most) of the compressed input, returning their length.
+static size_t
+read_compressed(codec_stream_t *codec) {
+  const size_t len = fread(codec->buffer, sizeof(char), PIPELINE_IO_SIZE, codec->file);
+
+  if (len == 0) {
+    if (ferror(codec->file)) {
+      fprintf(stderr, "error: unable to read the input.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    codec->input_end = 1;
+  }
+
+  return len;
+}
+
+/**
+* This function decodes up to capacity bytes of the message into out, returning the number
+* decoded - which is less than capacity only once the input has been decoded in its entirety.
+*
+* Concatenated gzip members and zstd frames (i.e., appended archives) are decoded one after
+* another, as "gzip -d" and "zstd -d" would. The decoders are called even once the compressed 
+* input has been consumed, as each may still hold decoded bytes - an input is only truncated
+* should the decoder then make no progress part of the way through a member or frame.
+*/
+static size_t
+decode_block(codec_stream_t *codec, char *out, size_t capacity) {
+  if (codec->format == NoCodec) {
+    const size_t len = fread(out, sizeof(char), capacity, codec->file);
+
+    if (len < capacity && ferror(codec->file)) {
+      fprintf(stderr, "error: unable to read the input.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    return len;
+  }
+
+#ifdef VIGENERE_ZLIB
+  if (codec->format == Gzip) {
+    z_stream *stream = &codec->zlib;
+
+    stream->next_out = (Bytef *)out;
+    stream->avail_out = (uInt)capacity;
+
+    while (stream->avail_out > 0) {
+      if (stream->avail_in == 0 && !codec->input_end) {
+        stream->avail_in = (uInt)read_compressed(codec);
+        stream->next_in = codec->buffer;
+      }
+
+      if (stream->avail_in == 0 && codec->input_end && !codec->in_frame) break;
+
+      const int status = inflate(stream, Z_NO_FLUSH);
+
+      // Each member is followed by either the next, or the end of the input.
+      if (status == Z_STREAM_END) {
+        codec->in_frame = 0;
+        inflateReset(stream);
+      }
+      else if (status == Z_OK) codec->in_frame = 1;
+      else exit_invalid_input(codec, status == Z_BUF_ERROR && codec->input_end);
+    }
+
+    return capacity - stream->avail_out;
+  }
+#endif
+
+#ifdef VIGENERE_ZSTD
+  if (codec->format == Zstd) {
+    ZSTD_outBuffer output = { out, capacity, 0 };
+
+    while (output.pos < output.size) {
+      if (codec->zstd_input.pos == codec->zstd_input.size && !codec->input_end) {
+        codec->zstd_input.src = codec->buffer;
+        codec->zstd_input.size = read_compressed(codec);
+        codec->zstd_input.pos = 0;
+      }
+
+      const int drained = codec->zstd_input.pos == codec->zstd_input.size && codec->input_end;
+      if (drained && !codec->in_frame) break;
+
+      const size_t decoded = output.pos, status = ZSTD_decompressStream(codec->dstream, &output, &codec->zstd_input);
+
+      // A status of 0 denotes the end of a frame, otherwise the decoder expects more of it.
+      if (ZSTD_isError(status)) exit_invalid_input(codec, 0);
+      codec->in_frame = status != 0;
+      if (drained && codec->in_frame && output.pos == decoded) exit_invalid_input(codec, 1);
+    }
+
+    return output.pos;
+  }
+#endif
+
+  return 0;
+}
+
+/**
+* This function encodes the len bytes of data into the output, writing the compressed data 
+* PIPELINE_IO_SIZE bytes at a time. Should last be non-zero, the stream is then ended,
+* whereby the encoder flushes whatever remains buffered (alongside the gzip trailer).
+*/
+static void
+encode_block(codec_stream_t *codec, const char *data, size_t len, int last) {
+  if (codec->format == NoCodec) {
+    write_output(data, len, codec->file);
+    return;
+  }
+
+#ifdef VIGENERE_ZLIB
+  if (codec->format == Gzip) {
+    z_stream *stream = &codec->zlib;
+
+    stream->next_in = (Bytef *)data;
+    stream->avail_in = (uInt)len;
+
+    // The output is full should deflate() have more to write (see https://zlib.net/zlib_how.html).
+    do {
+      stream->next_out = codec->buffer;
+      stream->avail_out = PIPELINE_IO_SIZE;
+
+      if (deflate(stream, last ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+        fprintf(stderr, "error: unable to compress the output.\n");
+        exit(EXIT_FAILURE);
+      }
+
+      write_output((const char *)codec->buffer, PIPELINE_IO_SIZE - stream->avail_out, codec->file);
+    } while (stream->avail_out == 0);
+  }
+#endif
+
+#ifdef VIGENERE_ZSTD
+  if (codec->format == Zstd) {
+    ZSTD_inBuffer input = { data, len, 0 };
+    size_t remaining;
+
+    // Whilst ending the frame, ZSTD_compressStream2() returns the bytes it has yet to flush.
+    do {
+      ZSTD_outBuffer output = { codec->buffer, PIPELINE_IO_SIZE, 0 };
+
+      remaining = ZSTD_compressStream2(codec->cctx, &output, &input, last ? ZSTD_e_end : ZSTD_e_continue);
+      if (ZSTD_isError(remaining)) {
+        fprintf(stderr, "error: unable to compress the output (%s).\n", ZSTD_getErrorName(remaining));
+        exit(EXIT_FAILURE);
+      }
+
+      write_output((const char *)codec->buffer, output.pos, codec->file);
+    } while (last ? remaining != 0 : input.pos < input.size);
+  }
+#endif
+}
+
+// The decoding stage, which fills each block with the decoded input until the input ends.
+static void *
+pipeline_decode(void *arg) {
+  pipeline_t *pipeline = (pipeline_t *)arg;
+
+  for (size_t block_ctr = 0;; block_ctr++) {
+    pipeline_block_t *block = pipeline_wait(pipeline, DecodeStage, block_ctr);
+
+    block->len = decode_block(&pipeline->decoder, block->data, pipeline->block_size);
+    block->last = block->len < pipeline->block_size;
+    pipeline_done(pipeline, DecodeStage);
+
+    if (block->last) return NULL;
+  }
+}
+
+// The encoding stage, which encodes each transformed block into the output, ending it with the last.
+static void *
+pipeline_encode(void *arg) {
+  pipeline_t *pipeline = (pipeline_t *)arg;
+
+  for (size_t block_ctr = 0;; block_ctr++) {
+    pipeline_block_t *block = pipeline_wait(pipeline, EncodeStage, block_ctr);
+    const int last = block->last;
+
+    encode_block(&pipeline->encoder, block->data, block->len, last);
+    pipeline_done(pipeline, EncodeStage);
+
+    if (last) return NULL;
+  }
+}
+
+#endif
+
+/**
+* This function transforms a compressed message (or into a compressed output), that is, 
+* "--decompress" and/or "--compress" - replacing "zstd -d | ./vigenere - ... | zstd", which 
+* copies the message through two pipes (and three processes).
+*
+* The decoded input is handed to the transformation in blocks, and the transformed blocks to
+* the encoder, without being copied - each of the three stages (see stages_t) runs within its
+* own thread, connected by bounded queues (see pipeline_t). Whilst one block is transformed, 
+* the next is thus being decoded and the previous encoded. As with stream_message(), memory
+* usage is constant regardless of the size of the message (PIPELINE_DEPTH blocks).
+*/
+static void
+pipeline_message(config_t *config) {
+#ifdef VIGENERE_CODEC
+  pipeline_t *pipeline = (pipeline_t *)alloc_buffer(&config->arena, sizeof(pipeline_t), "the pipeline");
+  FILE *input = stdin, *output = stdout;
+  pthread_t decode_thread, encode_thread;
+
+  open_streams(config, &input, &output);
+  memset(pipeline, 0, sizeof(*pipeline));
+  pipeline->block_size = config->threads > 1 ? (size_t)config->threads * PARALLEL_CHUNK_SIZE : PIPELINE_BLOCK_SIZE;
+
+  for (int block_ctr = 0; block_ctr < PIPELINE_DEPTH; block_ctr++)
+    pipeline->blocks[block_ctr].data = (char *)alloc_buffer(&config->arena, pipeline->block_size, "the pipeline blocks");
+
+  open_codec(&pipeline->decoder, config->decompress, input, 
+             (unsigned char *)alloc_buffer(&config->arena, PIPELINE_IO_SIZE, "the compressed input"), 0);
+  open_codec(&pipeline->encoder, config->compress, output, 
+             (unsigned char *)alloc_buffer(&config->arena, PIPELINE_IO_SIZE, "the compressed output"), 1);
+
+  pthread_mutex_init(&pipeline->lock, NULL);
+  pthread_cond_init(&pipeline->progress, NULL);
+
+  if (pthread_create(&decode_thread, NULL, pipeline_decode, pipeline) != 0 || 
+      pthread_create(&encode_thread, NULL, pipeline_encode, pipeline) != 0) {
+    fprintf(stderr, "error: unable to create the threads of the pipeline.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // The transformation runs upon this thread, as the key state is carried from one block to the next.
+  for (size_t block_ctr = 0;; block_ctr++) {
+    pipeline_block_t *block = pipeline_wait(pipeline, CipherStage, block_ctr);
+    const int last = block->last;
+
+    STATS_TRANSFORMED(config, block->data, block->len);
+    STATS_BEGIN(config, Transform);
+    transform_text(config, block->data, block->data, block->len);
+    STATS_END(config, Transform);
+
+    pipeline_done(pipeline, CipherStage);
+    if (last) break;
+  }
+
+  pthread_join(decode_thread, NULL);
+  pthread_join(encode_thread, NULL);
+  pthread_cond_destroy(&pipeline->progress);
+  pthread_mutex_destroy(&pipeline->lock);
+
+  close_codec(&pipeline->decoder, 0);
+  close_codec(&pipeline->encoder, 1);
+  close_streams(input, output);
+#else
+  (void)config;
+  fprintf(stderr, "error: --decompress and --compress are unavailable (compile with -DVIGENERE_ZLIB and/or "
+                  "-DVIGENERE_ZSTD).\n");
+  exit(EXIT_FAILURE);
+#endif
+}
+
+/**
+* This function reads the checkpoint of the index ("--index") nearest to (although not
+* beyond) offset - that is, the offset of the checkpoint (checkpoint_offset), and the 
+* number of characters within the alphabet which precede it (checkpoint_count).
+*
+* Should the index be shorter than the message (i.e., it is of a shorter message), the
+* last checkpoint is used instead, which is merely slower.
+*/
+static void
+read_checkpoint(const config_t *config, size_t offset, size_t *checkpoint_offset, size_t *checkpoint_count) {
+  FILE *index;
+  unsigned char header[INDEX_HEADER_SIZE], checkpoint[8];
+
+  if ((index = fopen(config->index_path, "rb")) == NULL) {
+    fprintf(stderr, "error: unable to open '%s' for reading.\n", config->index_path);
+    exit(EXIT_FAILURE);
+  }
+
+  if (fread(header, 1, sizeof(header), index) != sizeof(header) || memcmp(header, INDEX_MAGIC, 4) != 0 || 
+      load_be(header + 4, 4) == 0 || load_be(header + 8, 4) != (unsigned long long)config->alphabet) {
+    fprintf(stderr, "error: '%s' is not an index of a message within this alphabet.\n", config->index_path);
+    exit(EXIT_FAILURE);
+  }
+
+  if (fseek(index, 0, SEEK_END) != 0 || ftell(index) < INDEX_HEADER_SIZE) {
+    fprintf(stderr, "error: unable to read the index.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // The last checkpoint is used should the checkpoint lie beyond the end of the index.
+  const size_t interval = (size_t)load_be(header + 4, 4), 
+               entries = (size_t)(ftell(index) - INDEX_HEADER_SIZE) / sizeof(checkpoint),
+               entry = offset / interval < entries ? offset / interval : entries;
+
+  *checkpoint_offset = *checkpoint_count = 0;
+
+  if (entry > 0) {
+    if (seek_offset(index, INDEX_HEADER_SIZE + (entry - 1) * sizeof(checkpoint)) != 0 || 
+        fread(checkpoint, 1, sizeof(checkpoint), index) != sizeof(checkpoint)) {
+      fprintf(stderr, "error: unable to read the index.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    *checkpoint_offset = entry * interval;
+    *checkpoint_count = (size_t)load_be(checkpoint, sizeof(checkpoint));
+  }
+
+  fclose(index);
+}
+
+/**
+* This function transforms only the range of bytes [begin, end) of the message ("--range"),
+* which must be a file, as opposed to the entire message.
+*
+* The key position at begin depends upon the number of characters within the alphabet that
+* precede it - these are counted from the nearest checkpoint of the index (should one be
+* supplied via "--index"), otherwise from the start of the message. As counting is faster 
+* than transforming (and the input preceding the checkpoint is never read), a range costs
+* O(end - begin), rather than O(end).
+*/
+static void
+range_message(config_t *config) {
+  FILE *input = stdin, *output = stdout;
+  size_t offset = 0, count = 0, bytes_read = 0;
+
+  open_streams(config, &input, &output);
+  if (config->index_path != NULL) read_checkpoint(config, config->range_begin, &offset, &count);
+
+  if (seek_offset(input, offset) != 0) {
+    fprintf(stderr, "error: a range may only be selected of a file.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  const size_t chunk_size = config->threads > 1 ? (size_t)config->threads * PARALLEL_CHUNK_SIZE : STREAM_CHUNK_SIZE;
+  config->message = (char *)alloc_buffer(&config->arena, sizeof(char) * chunk_size, "the stream buffer");
+
+  // The characters between the checkpoint and the start of the range are counted, but not transformed.
+  while (offset < config->range_begin && 
+         (bytes_read = fread(config->message, sizeof(char), 
+                             config->range_begin - offset < chunk_size ? config->range_begin - offset : chunk_size, input)) > 0) {
+    count += vigenere_count_alphabet(config->message, bytes_read, config->alphabet);
+    offset += bytes_read;
+  }
+
+  config->key_state.key_pos = count % config->key_state.key_len;
+
+  while (offset < config->range_end && 
+         (bytes_read = fread(config->message, sizeof(char), 
+                             config->range_end - offset < chunk_size ? config->range_end - offset : chunk_size, input)) > 0) {
+    STATS_TRANSFORMED(config, config->message, bytes_read);
+    STATS_BEGIN(config, Transform);
+    transform_text(config, config->message, config->message, bytes_read);
+    STATS_END(config, Transform);
+
+    write_output(config->message, bytes_read, output);
+    offset += bytes_read;
+  }
+
+  close_streams(input, output);
+}
+
+#ifdef VIGENERE_TREE
+
+/**
+* A bounded, lock-free queue of many producers and many consumers (Dmitry Vyukov's), of
+* TREE_QUEUE_SIZE items. The sequence of each cell denotes whether it is ready to be pushed
+* into (sequence = position) or popped from (sequence = position + 1), hence a position is 
+* claimed by a single compare-and-swap of the tail (or head) - and no thread ever blocks 
+* another part of the way through a push or a pop.
+*
+* The head and tail are kept upon separate cache lines, so that the producer and consumers
+* do not contend for the same line.
+*
+* https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+*/
+typedef struct tree_cell {
+  size_t sequence;
+  void *item;
+} tree_cell_t;
+
+typedef struct tree_queue {
+  tree_cell_t cells[TREE_QUEUE_SIZE];
+  size_t head __attribute__((aligned(64))); // the next position to pop.
+  size_t tail __attribute__((aligned(64))); // the next position to push.
+} tree_queue_t;
+
+static void
+queue_init(tree_queue_t *queue) {
+  for (size_t cell_ctr = 0; cell_ctr < TREE_QUEUE_SIZE; cell_ctr++) queue->cells[cell_ctr].sequence = cell_ctr;
+  queue->head = queue->tail = 0;
+}
+
+// Pushes item into the queue, yielding the processor whilst the queue is full.
+static void
+queue_push(tree_queue_t *queue, void *item) {
+  size_t pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+  tree_cell_t *cell;
+
+  for (;;) {
+    cell = &queue->cells[pos & (TREE_QUEUE_SIZE - 1)];
+
+    const intptr_t diff = (intptr_t)__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - (intptr_t)pos;
+
+    // A failed compare-and-swap reloads pos, whereby another position is attempted.
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&queue->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else {
+      if (diff < 0) sched_yield();
+      pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    }
+  }
+
+  cell->item = item;
+  __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+}
+
+// Pops the next item from the queue, yielding the processor whilst the queue is empty.
+static void *
+queue_pop(tree_queue_t *queue) {
+  size_t pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+  tree_cell_t *cell;
+
+  for (;;) {
+    cell = &queue->cells[pos & (TREE_QUEUE_SIZE - 1)];
+
+    const intptr_t diff = (intptr_t)__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - (intptr_t)(pos + 1);
+
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&queue->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else {
+      if (diff < 0) sched_yield();
+      pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    }
+  }
+
+  void *item = cell->item;
+
+  __atomic_store_n(&cell->sequence, pos + TREE_QUEUE_SIZE, __ATOMIC_RELEASE);
+  return item;
+}
+
+/**
+* A batch of files, identified by their paths relative to both the input and the output
+* directories. A batch without files instructs the worker popping it to stop.
+*/
+typedef struct tree_batch {
+  size_t file_count;
+  size_t paths_len;
+  char paths[TREE_BATCH_PATHS]; // the path of each file, each terminated by '\0'.
+} tree_batch_t;
+
+/**
+* The state of the recursive mode - batches circulate from the free queue, to the walk
+* (which fills them), to the full queue, to a worker (which transforms their files), and
+* back to the free queue. As such, the batches are allocated once.
+*/
+typedef struct tree {
+  const config_t *config;
+  tree_queue_t full, free;
+  tree_batch_t *batch; // the batch being filled by the walk, or NULL.
+  dev_t output_dev; // the output directory, which is never walked (should it be within the input).
+  ino_t output_ino;
+  size_t failed; // the files (and directories) which could not be transformed (incremented atomically, by the walk and workers alike).
+} tree_t;
+
+/**
+* Each worker transforms its files using its own arena, from which its buffer and copy of
+* the shift table are allocated once - the key position is simply reset at each file.
+*/
+typedef struct tree_worker {
+  tree_t *tree;
+  vigenere_arena_t arena;
+  key_state_t key_state;
+  char *buffer;
+  pthread_t thread;
+} tree_worker_t;
+
+// Joins root and relative (should it not be empty) into path, returning -1 should it be too long.
+static int
+tree_path(char *path, const char *root, const char *relative) {
+  const int path_len = snprintf(path, TREE_PATH_MAX, *relative != '\0' ? "%s/%s" : "%s", root, relative);
+  return path_len < 0 || path_len >= TREE_PATH_MAX ? -1 : 0;
+}
+
+/**
+* This function transforms a single file (relative_path) into the output directory, as 
+* though it were supplied by itself (that is, from the start of the key).
+*
+* The file is read up to the size reported by fstat() - a file smaller than the buffer
+* therefore costs a single read() and write().
+*
+* Returns 0 upon success, otherwise -1.
+*/
+static int
+tree_transform_file(tree_worker_t *worker, const char *relative_path) {
+  const config_t *config = worker->tree->config;
+  char input_path[TREE_PATH_MAX], output_path[TREE_PATH_MAX];
+  struct stat input_stat;
+  int input_fd, output_fd, status = 0;
+
+  if (tree_path(input_path, config->tree_path, relative_path) != 0 || 
+      tree_path(output_path, config->output_path, relative_path) != 0 ||
+      (input_fd = open(input_path, O_RDONLY)) < 0) return -1;
+
+  if (fstat(input_fd, &input_stat) != 0 || 
+      (output_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, input_stat.st_mode & 0777)) < 0) {
+    close(input_fd);
+    return -1;
+  }
+
+  size_t remaining = (size_t)input_stat.st_size;
+  ssize_t bytes_read;
+
+  worker->key_state.key_pos = 0;
+  while (remaining > 0 && 
+         (bytes_read = read(input_fd, worker->buffer, remaining < TREE_BUFFER_SIZE ? remaining : TREE_BUFFER_SIZE)) != 0) {
+    if (bytes_read < 0 && errno == EINTR) continue;
+    if (bytes_read < 0) {
+      status = -1;
+      break;
+    }
+
+    vigenere_transform(worker->buffer, (size_t)bytes_read, &worker->key_state, (modes_t)config->option);
+    if (write_all(output_fd, worker->buffer, (size_t)bytes_read) != 0) {
+      status = -1;
+      break;
+    }
+
+    remaining -= (size_t)bytes_read;
+  }
+
+  close(input_fd);
+  return close(output_fd) != 0 ? -1 : status;
+}
+
+// Thread entry point of each worker - transforms the files of each batch, until told to stop.
+static void *
+tree_work(void *arg) {
+  tree_worker_t *worker = (tree_worker_t *)arg;
+  tree_t *tree = worker->tree;
+  tree_batch_t *batch;
+
+  while ((batch = (tree_batch_t *)queue_pop(&tree->full))->file_count > 0) {
+    const char *path = batch->paths;
+
+    for (size_t file_ctr = 0; file_ctr < batch->file_count; file_ctr++, path += strlen(path) + 1) {
+      if (tree_transform_file(worker, path) != 0) {
+        fprintf(stderr, "error: unable to transform '%s/%s'.\n", tree->config->tree_path, path);
+        __atomic_add_fetch(&tree->failed, 1, __ATOMIC_RELAXED);
+      }
+    }
+
+    queue_push(&tree->free, batch);
+  }
+
+  return NULL;
+}
+
+// Adds a file to the batch being filled, which is pushed to the workers once full.
+static void
+tree_add_file(tree_t *tree, const char *relative_path) {
+  const size_t path_len = strlen(relative_path) + 1;
+
+  if (tree->batch != NULL && 
+      (tree->batch->file_count == TREE_BATCH_FILES || tree->batch->paths_len + path_len > TREE_BATCH_PATHS)) {
+    queue_push(&tree->full, tree->batch);
+    tree->batch = NULL;
+  }
+
+  if (tree->batch == NULL) {
+    tree->batch = (tree_batch_t *)queue_pop(&tree->free);
+    tree->batch->file_count = tree->batch->paths_len = 0;
+  }
+
+  memcpy(tree->batch->paths + tree->batch->paths_len, relative_path, path_len);
+  tree->batch->paths_len += path_len;
+  tree->batch->file_count++;
+}
+
+/**
+* The directories yet to be walked, as their relative paths (each terminated by '\0') one
+* after another - the walk takes the last, and appends the subdirectories found within it.
+* The paths are allocated from the walk's own arena, and twice the size is allocated
+* should they no longer fit (the previous allocation being released alongside the arena).
+*/
+typedef struct tree_stack {
+  vigenere_arena_t arena;
+  char *paths; // the relative paths, each terminated by '\0'.
+  size_t len, size; // the bytes of paths in use, and allocated.
+} tree_stack_t;
+
+// Appends a relative path (of path_len bytes, excluding '\0') to the directories yet to be walked.
+static void
+tree_push(tree_stack_t *stack, const char *relative_path, size_t path_len) {
+  if (stack->len + path_len + 1 > stack->size) {
+    const size_t size = 2 * (stack->len + path_len + 1 > TREE_PATH_MAX ? stack->len + path_len + 1 : TREE_PATH_MAX);
+    char *paths = (char *)alloc_buffer(&stack->arena, size, "the directories of the walk");
+
+    if (stack->len > 0) memcpy(paths, stack->paths, stack->len);
+    stack->paths = paths;
+    stack->size = size;
+  }
+
+  memcpy(stack->paths + stack->len, relative_path, path_len + 1);
+  stack->len += path_len + 1;
+}
+
+// Removes the last relative path from the directories yet to be walked, copying it into relative_path.
+static void
+tree_pop(tree_stack_t *stack, char *relative_path) {
+  size_t start = stack->len - 1;
+
+  while (start > 0 && stack->paths[start - 1] != '\0') start--;
+
+  memcpy(relative_path, stack->paths + start, stack->len - start);
+  stack->len = start;
+}
+
+/**
+* This function walks the directory relative_path (relative to "-r", whereby "" is "-r" 
+* itself), creating its counterpart within the output directory and adding each of its
+* regular files to a batch. Symbolic links (and other special files) are skipped.
+*
+* Its subdirectories are appended to the stack, rather than walked recursively - as such,
+* the depth of the tree is bounded by TREE_PATH_MAX alone (rather than by the stack of the
+* thread), and only a single directory is ever open at once.
+*/
+static void
+tree_walk_directory(tree_t *tree, tree_stack_t *stack, const char *relative_path) {
+  char path[TREE_PATH_MAX], child_path[TREE_PATH_MAX];
+  struct stat dir_stat;
+  struct dirent *entry;
+  DIR *dir;
+
+  if (tree_path(path, tree->config->tree_path, relative_path) != 0 || (dir = opendir(path)) == NULL) {
+    fprintf(stderr, "error: unable to open the directory '%s%s%s'.\n", tree->config->tree_path, 
+            *relative_path != '\0' ? "/" : "", relative_path);
+    __atomic_add_fetch(&tree->failed, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  if (fstat(dirfd(dir), &dir_stat) == 0 && dir_stat.st_dev == tree->output_dev && dir_stat.st_ino == tree->output_ino) {
+    closedir(dir);
+    return;
+  }
+
+  if (*relative_path != '\0' && 
+      (tree_path(path, tree->config->output_path, relative_path) != 0 || (mkdir(path, 0777) != 0 && errno != EEXIST))) {
+    fprintf(stderr, "error: unable to create the directory '%s/%s'.\n", tree->config->output_path, relative_path);
+    __atomic_add_fetch(&tree->failed, 1, __ATOMIC_RELAXED);
+    closedir(dir);
+    return;
+  }
+
+  while ((entry = readdir(dir)) != NULL) {
+    if (strncmp(entry->d_name, ".", 2) == 0 || strncmp(entry->d_name, "..", 3) == 0) continue;
+
+    const int child_len = snprintf(child_path, TREE_PATH_MAX, *relative_path != '\0' ? "%s/%s" : "%s%s", 
+                                   relative_path, entry->d_name);
+
+    if (child_len < 0 || child_len >= TREE_PATH_MAX) {
+      fprintf(stderr, "error: the path of '%s' is too long.\n", entry->d_name);
+      __atomic_add_fetch(&tree->failed, 1, __ATOMIC_RELAXED);
+      continue;
+    }
+
+    unsigned char type = entry->d_type;
+    struct stat child_stat;
+
+    // Not every file system reports the type of each entry, whereby this is determined via lstat().
+    if (type == DT_UNKNOWN && tree_path(path, tree->config->tree_path, child_path) == 0 && lstat(path, &child_stat) == 0)
+      type = S_ISDIR(child_stat.st_mode) ? DT_DIR : S_ISREG(child_stat.st_mode) ? DT_REG : DT_UNKNOWN;
+
+    if (type == DT_DIR) tree_push(stack, child_path, (size_t)child_len);
+    else if (type == DT_REG) tree_add_file(tree, child_path);
+  }
+
+  closedir(dir);
+}
+
+// Walks the whole of "-r" (see tree_walk_directory()), one directory at a time.
+static void
+tree_walk(tree_t *tree) {
+  char relative_path[TREE_PATH_MAX];
+  tree_stack_t stack = { .paths = NULL, .len = 0, .size = 0 };
+
+  vigenere_arena_init(&stack.arena, NULL, 0);
+  tree_push(&stack, "", 0);
+
+  while (stack.len > 0) {
+    tree_pop(&stack, relative_path);
+    tree_walk_directory(tree, &stack, relative_path);
+  }
+
+  vigenere_arena_release(&stack.arena);
+}
+
+#endif
+
+/**
+* This function transforms every file within the directory "-r" (recursively) into the
+* directory "-o", each file as though it were supplied by itself.
+*
+* The directory is walked upon the calling thread, which hands the files to the workers
+* ("-j", each upon its own thread) in batches through a lock-free queue (see queue_push()).
+* As the workers share nothing but the queues, throughput scales with the threads, whilst
+* the batches amortise the cost of the queue across many small files.
+*/
+static void
+tree_message(config_t *config) {
+#ifdef VIGENERE_TREE
+  tree_t *tree = (tree_t *)alloc_buffer(&config->arena, sizeof(tree_t), "the recursive mode");
+  tree_batch_t *batches = (tree_batch_t *)alloc_buffer(&config->arena, TREE_QUEUE_SIZE * sizeof(tree_batch_t), "the batches");
+  tree_worker_t workers[MAX_THREADS];
+  struct stat output_stat;
+  int worker_count = 0;
+
+  if ((mkdir(config->output_path, 0777) != 0 && errno != EEXIST) || 
+      stat(config->output_path, &output_stat) != 0 || !S_ISDIR(output_stat.st_mode)) {
+    fprintf(stderr, "error: unable to create the directory '%s'.\n", config->output_path);
+    exit(EXIT_FAILURE);
+  }
+
+  tree->config = config;
+  tree->batch = NULL;
+  tree->output_dev = output_stat.st_dev;
+  tree->output_ino = output_stat.st_ino;
+  tree->failed = 0;
+  queue_init(&tree->full);
+  queue_init(&tree->free);
+  for (size_t batch_ctr = 0; batch_ctr < TREE_QUEUE_SIZE; batch_ctr++) queue_push(&tree->free, &batches[batch_ctr]);
+
+  // The kernel is selected prior to starting the workers, rather than by each of them at once.
+  vigenere_kernel();
+
+  for (int worker_ctr = 0; worker_ctr < config->threads; worker_ctr++) {
+    tree_worker_t *worker = &workers[worker_count];
+    const size_t shifts_len = config->key_state.key_len + KEY_RING_PADDING;
+
+    worker->tree = tree;
+    vigenere_arena_init(&worker->arena, NULL, 0);
+    worker->buffer = (char *)alloc_buffer(&worker->arena, TREE_BUFFER_SIZE, "a worker's buffer");
+    unsigned char *shifts = (unsigned char *)alloc_buffer(&worker->arena, shifts_len, "a worker's shift table");
+
+    memcpy(shifts, config->key_state.shifts, shifts_len);
+    worker->key_state = config->key_state;
+    worker->key_state.shifts = shifts;
+
+    if (pthread_create(&worker->thread, NULL, tree_work, worker) == 0) worker_count++;
+    else vigenere_arena_release(&worker->arena);
+  }
+
+  if (worker_count == 0) {
+    fprintf(stderr, "error: unable to create the worker threads.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  tree_walk(tree);
+  if (tree->batch != NULL) queue_push(&tree->full, tree->batch);
+
+  // Each worker stops upon popping the (empty) stop batch, once the batches preceding it are done.
+  tree_batch_t stop = { 0, 0, { 0 } };
+
+  for (int worker_ctr = 0; worker_ctr < worker_count; worker_ctr++) queue_push(&tree->full, &stop);
+  for (int worker_ctr = 0; worker_ctr < worker_count; worker_ctr++) {
+    pthread_join(workers[worker_ctr].thread, NULL);
+    vigenere_arena_release(&workers[worker_ctr].arena);
+  }
+
+  if (tree->failed > 0) {
+    fprintf(stderr, "error: %zu file(s) could not be transformed.\n", tree->failed);
+    exit(EXIT_FAILURE);
+  }
+#else
+  (void)config;
+  fprintf(stderr, "error: -r is unavailable upon this platform.\n");
+  exit(EXIT_FAILURE);
+#endif
+}
+
+/**
+* This function transforms newline-delimited records (one per line), that is,
+* the batch mode "lines".
+*
+* As only the record boundaries (the newlines) are of interest, these are located
+* within each chunk using memchr(), and the key position reset at each should "-R"
+* be specified. Records are therefore never held in their entirety, and may be of
+* any length.
+*
+* https://cplusplus.com/reference/cstring/memchr/
+*/
+static void
+batch_lines(config_t *config, FILE *input, FILE *output) {
+  size_t bytes_read = 0;
+
+  while ((bytes_read = fread(config->message, sizeof(char), STREAM_CHUNK_SIZE, input)) > 0) {
+    char *record = config->message, *end = config->message + bytes_read, *newline = NULL;
+
+    STATS_RECORDS(config, config->message, bytes_read);
+
+    // The records of each chunk are timed together, as opposed to individually.
+    STATS_BEGIN(config, Transform);
+    while ((newline = (char *)memchr(record, '\n', (size_t)(end - record))) != NULL) {
+      vigenere_transform(record, (size_t)(newline - record), &config->key_state, config->option);
+      if (config->reset_key) config->key_state.key_pos = 0;
+      record = newline + 1;
+    }
+
+    // The remainder of the chunk belongs to a record continuing within the next chunk.
+    vigenere_transform(record, (size_t)(end - record), &config->key_state, config->option);
+    STATS_END(config, Transform);
+
+    write_output(config->message, bytes_read, output);
+  }
+}
+
+/**
+* This function transforms length-prefixed records, that is, the batch mode "prefixed".
+*
+* Each record is preceded by its length as a 4-byte, big-endian integer, which is
+* written to the output unchanged. This allows records to contain any bytes 
+* (including newlines). Similarly, the payload is processed one chunk at a time.
+*/
+static void
+batch_prefixed(config_t *config, FILE *input, FILE *output) {
+  unsigned char header[4];
+
+  while (fread(header, sizeof(unsigned char), sizeof(header), input) == sizeof(header)) {
+    size_t record_len = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | 
+                        ((size_t)header[2] << 8) | (size_t)header[3];
+
+    if (config->reset_key) config->key_state.key_pos = 0;
+    write_output((const char *)header, sizeof(header), output);
+
+    while (record_len > 0) {
+      const size_t chunk_len = record_len < STREAM_CHUNK_SIZE ? record_len : STREAM_CHUNK_SIZE;
+  
+      if (fread(config->message, sizeof(char), chunk_len, input) != chunk_len) {
+        fprintf(stderr, "error: truncated record within the input.\n");
+        exit(EXIT_FAILURE);
+      }
+
+      STATS_TRANSFORMED(config, config->message, chunk_len);
+      STATS_BEGIN(config, Transform);
+      vigenere_transform(config->message, chunk_len, &config->key_state, config->option);
+      STATS_END(config, Transform);
+
+      write_output(config->message, chunk_len, output);
+      record_len -= chunk_len;
+    }
+  }
+}
+
+/**
+* This function reads the entirety of a (small) file, such as the keys file, into a buffer
+* (allocated from the arena) which is terminated by '\0'. The length (excluding '\0') is
+* stored within len.
+*/
+static char *
+read_file(vigenere_arena_t *arena, const char *path, size_t *len) {
+  FILE *file = fopen(path, "rb");
+  long file_len = 0;
+  char *buffer = NULL;
+
+  if (file == NULL || fseek(file, 0, SEEK_END) != 0 || (file_len = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) {
+    fprintf(stderr, "error: unable to open '%s' for reading.\n", path);
+    exit(EXIT_FAILURE);
+  }
+
+  buffer = (char *)alloc_buffer(arena, (size_t)file_len + 1, "the file buffer");
+
+  if (fread(buffer, sizeof(char), (size_t)file_len, file) != (size_t)file_len) {
+    fprintf(stderr, "error: unable to read '%s'.\n", path);
+    exit(EXIT_FAILURE);
+  }
+
+  buffer[file_len] = '\0';
+  fclose(file);
+
+  *len = (size_t)file_len;
+  return buffer;
+}
+
+/**
+* This function reads the key from the file ("--key-file") or the environment variable
+* ("--key-env") in place of "-k", either of which keeps the key out of argv (that is, out of
+* the process list and the shell's history). The key of a file ends at its first line break.
+*/
+static void
+load_key(config_t *config) {
+  size_t key_len = 0;
+
+  if (config->key_path != NULL) {
+    config->key = read_file(&config->arena, config->key_path, &key_len);
+    config->key[strcspn(config->key, "\r\n")] = '\0';
+  }
+  else if (config->key_env != NULL && (config->key = getenv(config->key_env)) == NULL) {
+    fprintf(stderr, "error: the environment variable '%s' is not set.\n", config->key_env);
+    exit(EXIT_FAILURE);
+  }
+
+  if (config->key[0] == '\0') {
+    fprintf(stderr, "error: the key is empty.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Computes the FNV-1a hash of the key ID (of length id_len).
+static size_t
+hash_key_id(const char *id, size_t id_len) {
+  unsigned long long hash = 14695981039346656037ULL;
+
+  for (size_t id_ctr = 0; id_ctr < id_len; id_ctr++)
+    hash = (hash ^ (unsigned char)id[id_ctr]) * 1099511628211ULL;
+
+  return (size_t)hash;
+}
+
+/**
+* This function loads the keys file ("-K"), whereby each line consists of a key ID,
+* followed by whitespace and the key itself (i.e., "tenant-42 LEMON").
+*
+* The file is read into a single buffer, within which the IDs and keys are terminated
+* in place - the entries therefore point into this buffer. The entries are then
+* indexed by a hash table (FNV-1a, open addressing) so that each record's key ID can
+* be looked up in constant time.
+*
+* https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+*/
+static void
+load_keyring(keyring_t *keyring, const char *path, vigenere_arena_t *arena) {
+  size_t keys_len = 0;
+
+  memset(keyring, 0, sizeof(*keyring));
+  keyring->arena = arena;
+  keyring->buffer = read_file(arena, path, &keys_len);
+
+  // Each line is at most one entry, hence the number of newlines bounds the entries.
+  size_t line_count = 1;
+  for (size_t char_ctr = 0; char_ctr < keys_len; char_ctr++)
+    line_count += keyring->buffer[char_ctr] == '\n';
+
+  keyring->entries = (key_entry_t *)alloc_buffer(arena, sizeof(key_entry_t) * line_count, "the keyring");
+
+  // The hash table is (at least) twice the number of entries, and a power of two.
+  keyring->table_size = 16;
+  while (keyring->table_size < line_count * 2) keyring->table_size *= 2;
+  keyring->table = (int *)alloc_buffer(arena, sizeof(int) * keyring->table_size, "the keyring");
+
+  for (size_t slot_ctr = 0; slot_ctr < keyring->table_size; slot_ctr++) keyring->table[slot_ctr] = -1;
+
+  for (char *line = keyring->buffer, *next = NULL; line != NULL && *line != '\0'; line = next) {
+    if ((next = strchr(line, '\n')) != NULL) *next++ = '\0';
+
+    // The ID is terminated at the first whitespace, and the key follows any further whitespace.
+    char *id = line, *key = line + strcspn(line, " \t");
+    if (*key != '\0') *key++ = '\0';
+    key += strspn(key, " \t");
+    key[strcspn(key, "\r")] = '\0';
+
+    // Blank lines are skipped, whereas a key ID without a key is erroneous.
+    if (*id == '\0') continue;
+    if (*key == '\0' || strlen(id) > MAX_KEY_ID_LEN) {
+      fprintf(stderr, "error: invalid entry for key ID '%s' within '%s'.\n", id, path);
+      exit(EXIT_FAILURE);
+    }
+
+    size_t slot = hash_key_id(id, strlen(id)) & (keyring->table_size - 1);
+    while (keyring->table[slot] != -1) slot = (slot + 1) & (keyring->table_size - 1);
+
+    keyring->entries[keyring->entry_count].id = id;
+    keyring->entries[keyring->entry_count].key = key;
+    keyring->entries[keyring->entry_count].cache_slot = -1;
+    keyring->table[slot] = (int)keyring->entry_count++;
+    if (strlen(key) > keyring->max_key_len) keyring->max_key_len = strlen(key);
+  }
+
+  keyring->head = keyring->tail = -1;
+}
+
+/**
+* This function returns the prepared key state for the key ID (of length id_len),
+* or NULL should the ID be absent from the keyring.
+*
+* The shift tables of the most recently used keys (up to KEY_CACHE_SIZE) are held
+* within an LRU cache - a doubly-linked list of the cache slots, whereby the head
+* is the most recently used. Upon a miss, the least recently used slot (the tail) is
+* evicted, and its shift buffer reused for the new key. vigenere_fill_shifts() is, therefore,
+* only called once per distinct key whilst the working set fits within the cache.
+*
+* The key position of the returned state is reset to the start of the key.
+*/
+static key_state_t *
+lookup_key(keyring_t *keyring, const char *id, size_t id_len) {
+  size_t slot = hash_key_id(id, id_len) & (keyring->table_size - 1);
+  int entry_idx = -1;
+
+  for (; keyring->table[slot] != -1; slot = (slot + 1) & (keyring->table_size - 1)) {
+    const key_entry_t *entry = &keyring->entries[keyring->table[slot]];
+
+    if (strncmp(entry->id, id, id_len) == 0 && entry->id[id_len] == '\0') {
+      entry_idx = keyring->table[slot];
+      break;
+    }
+  }
+
+  if (entry_idx == -1) return NULL;
+
+  key_entry_t *entry = &keyring->entries[entry_idx];
+  int cache_idx = entry->cache_slot;
+
+  if (cache_idx != -1) {
+    keyring->hits++;
+
+    // Unlink the slot, prior to relinking it at the head (below).
+    key_cache_slot_t *cached = &keyring->slots[cache_idx];
+    if (cached->prev != -1) keyring->slots[cached->prev].next = cached->next;
+    else keyring->head = cached->next;
+    if (cached->next != -1) keyring->slots[cached->next].prev = cached->prev;
+    else keyring->tail = cached->prev;
+  } else {
+    keyring->misses++;
+
+    // Either a free slot is claimed, or the least recently used slot is evicted.
+    if (keyring->slot_count < KEY_CACHE_SIZE) cache_idx = keyring->slot_count++;
+    else {
+      cache_idx = keyring->tail;
+      keyring->entries[keyring->slots[cache_idx].entry].cache_slot = -1;
+      keyring->tail = keyring->slots[cache_idx].prev;
+      if (keyring->tail != -1) keyring->slots[keyring->tail].next = -1;
+      else keyring->head = -1;
+    }
+
+    key_cache_slot_t *cached = &keyring->slots[cache_idx];
+    const size_t key_len = strlen(entry->key);
+
+    /**
+    * Each slot's buffer is sized for the longest key, so that it may hold any key upon
+    * eviction - it is thus allocated (from the arena) once, upon first use.
+    */
+    if (cached->shifts == NULL)
+      cached->shifts = (unsigned char *)alloc_buffer(keyring->arena, keyring->max_key_len + KEY_RING_PADDING, "the shift table");
+
+    fill_key_shifts(entry->key, key_len, keyring->alphabet, keyring->cipher, cached->shifts);
+    cached->key_state.shifts = cached->shifts;
+    cached->key_state.key_len = key_len;
+    cached->key_state.alphabet = keyring->alphabet;
+    cached->key_state.cipher = keyring->cipher;
+    cached->entry = entry_idx;
+    entry->cache_slot = cache_idx;
+  }
+
+  // The slot is (re)linked at the head, as the most recently used.
+  key_cache_slot_t *cached = &keyring->slots[cache_idx];
+  cached->prev = -1;
+  cached->next = keyring->head;
+  if (keyring->head != -1) keyring->slots[keyring->head].prev = cache_idx;
+  keyring->head = cache_idx;
+  if (keyring->tail == -1) keyring->tail = cache_idx;
+
+  cached->key_state.key_pos = 0;
+  return &cached->key_state;
+}
+
+/**
+* This function transforms newline-delimited records prefixed by a key ID, that is,
+* the batch mode "keyed" (i.e., "tenant-42<TAB>attack at dawn").
+*
+* The key ID (up to the first tab) selects the key from the keyring, and is written
+* to the output unchanged. Records with an empty key ID use the key specified via
+* "-k". Each record starts at the beginning of its key.
+*
+* Similarly to batch_lines(), records are processed one chunk at a time, hence the
+* key ID is accumulated across chunks should it span a chunk boundary.
+*/
+static void
+batch_keyed(config_t *config, FILE *input, FILE *output) {
+  char id[MAX_KEY_ID_LEN + 1];
+  size_t id_len = 0, bytes_read = 0, record_ctr = 1;
+  key_state_t *key_state = NULL; // NULL whilst reading the key ID of a record.
+
+  while ((bytes_read = fread(config->message, sizeof(char), STREAM_CHUNK_SIZE, input)) > 0) {
+    char *cursor = config->message, *end = config->message + bytes_read;
+
+    while (cursor < end) {
+      if (key_state == NULL) {
+
+        // The ID continues until the tab, which may lie within a subsequent chunk.
+        char *tab = (char *)memchr(cursor, '\t', (size_t)(end - cursor));
+        const size_t available = (size_t)((tab != NULL ? tab : end) - cursor);
+
+        if (id_len + available > MAX_KEY_ID_LEN || memchr(cursor, '\n', available) != NULL) {
+          fprintf(stderr, "error: record %zu does not begin with a valid key ID.\n", record_ctr);
+          exit(EXIT_FAILURE);
+        }
+
+        memcpy(id + id_len, cursor, available);
+        id_len += available;
+        cursor += available;
+
+        if (tab == NULL) break;
+
+        id[id_len] = '\0';
+        if (id_len == 0) {
+          config->key_state.key_pos = 0;
+          key_state = &config->key_state;
+        } else if ((key_state = lookup_key(config->keyring, id, id_len)) == NULL) {
+          fprintf(stderr, "error: record %zu uses an unknown key ID '%s'.\n", record_ctr, id);
+          exit(EXIT_FAILURE);
+        }
+
+        // The key ID (and the tab) are copied to the output as they are.
+        write_output(id, id_len, output);
+        write_output("\t", 1, output);
+        cursor++;
+        continue;
+      }
+
+      char *newline = (char *)memchr(cursor, '\n', (size_t)(end - cursor));
+      const size_t payload_len = (size_t)((newline != NULL ? newline + 1 : end) - cursor);
+
+      STATS_TRANSFORMED(config, cursor, payload_len);
+      STATS_BEGIN(config, Transform);
+      vigenere_transform(cursor, payload_len, key_state, config->option);
+      STATS_END(config, Transform);
+
+      write_output(cursor, payload_len, output);
+      cursor += payload_len;
+
+      if (newline != NULL) {
+        key_state = NULL;
+        id_len = 0;
+        record_ctr++;
+      }
+    }
+  }
+
+  // A final record without a tab (i.e., a trailing ID) is erroneous.
+  if (key_state == NULL && id_len > 0) {
+    fprintf(stderr, "error: record %zu does not begin with a valid key ID.\n", record_ctr);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+* This function is responsible for batch mode, whereby many records (messages) are
+* transformed with the same key, within a single process.
+*
+* As the shift table within config->key_state is generated once, prior to this
+* function being called, the cost of each record is solely that of transforming it.
+* Furthermore, a single buffer is used for every record - no allocations are
+* performed per record.
+*/
+static void
+batch_message(config_t *config) {
+  FILE *input = stdin, *output = stdout;
+
+  open_streams(config, &input, &output);
+  config->message = (char *)alloc_buffer(&config->arena, sizeof(char) * STREAM_CHUNK_SIZE, "the stream buffer");
+
+  if (config->batch == Keyed) {
+    keyring_t *keyring = (keyring_t *)alloc_buffer(&config->arena, sizeof(keyring_t), "the keyring");
+
+    // Loading the keys is akin to generating the keystream, hence is timed as such.
+    STATS_BEGIN(config, Keystream);
+    load_keyring(keyring, config->keys_path, &config->arena);
+    keyring->alphabet = config->alphabet;
+    keyring->cipher = config->cipher;
+    STATS_END(config, Keystream);
+    config->keyring = keyring;
+    batch_keyed(config, input, output);
+  }
+  else if (config->batch == Lines) batch_lines(config, input, output);
+  else batch_prefixed(config, input, output);
+
+  close_streams(input, output);
+
+  if (config->keyring != NULL) {
+    config->counters.cache_hits = config->keyring->hits;
+    config->counters.cache_misses = config->keyring->misses;
+  }
+}
+
+#ifdef VIGENERE_SERVE
+
+/**
+* A client of the server, which is buffered in both directions - requests are read into
+* input as they arrive, and their responses accumulated within output until written.
+*/
+typedef struct serve_client {
+  int fd; // the client's socket, or -1 should the slot be free.
+  unsigned char *input, *output; // allocated (from the arena) upon the slot's first use.
+  size_t input_len, output_len, output_pos;
+} serve_client_t;
+
+typedef struct server {
+  config_t *config;
+  int epoll_fd, listen_fd;
+  serve_client_t clients[SERVE_CONNECTIONS];
+  size_t *latencies; // the latency histogram (see SERVE_LATENCY_BUCKETS), or NULL without "--stats".
+} server_t;
+
+// Set by SIGINT/SIGTERM, whereupon the server stops (see serve_message()).
+static volatile sig_atomic_t serve_stopped = 0;
+
+static void
+serve_stop(int signal_number) {
+  (void)signal_number;
+  serve_stopped = 1;
+}
+
+// Returns the monotonic clock in nanoseconds.
+static unsigned long long
+serve_clock(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+/**
+* This function transforms every complete request buffered by the client, appending each
+* response to its output (in order, hence requests may be pipelined). Each request is:
+*
+*   mode (1 byte, 0 = encrypt, 1 = decrypt), key ID length (1 byte), payload length
+*   (2 bytes, big-endian), key ID, payload
+*
+* and each response is a status (1 byte, 0 = success, 1 = unknown key ID, 2 = invalid mode),
+* the payload length (2 bytes, big-endian), and the transformed payload (if successful).
+*
+* As the keys are prepared once (and cached thereafter, see lookup_key()), each request costs
+* only that of transforming its payload. Requests whose response does not fit within the
+* output are left buffered until the output has been written.
+*/
+static void
+serve_requests(server_t *server, serve_client_t *client) {
+  config_t *config = server->config;
+  size_t pos = 0;
+
+  while (client->input_len - pos >= SERVE_HEADER_SIZE) {
+    const unsigned char *request = client->input + pos;
+    const size_t id_len = request[1], payload_len = (size_t)load_be(request + 2, 2), 
+                 request_len = SERVE_HEADER_SIZE + id_len + payload_len;
+
+    if (client->input_len - pos < request_len || 
+        SERVE_BUFFER_SIZE - client->output_len < SERVE_RESPONSE_HEADER_SIZE + payload_len) break;
+
+    const unsigned long long start = server->latencies != NULL ? serve_clock() : 0;
+    unsigned char *response = client->output + client->output_len;
+    key_state_t *key_state = NULL;
+
+    response[0] = 1;
+    if (request[0] > Decrypt) response[0] = 2;
+    else if (id_len == 0) key_state = &config->key_state;
+    else if (config->keyring != NULL) key_state = lookup_key(config->keyring, (const char *)request + SERVE_HEADER_SIZE, id_len);
+
+    if (key_state != NULL) {
+      response[0] = 0;
+      key_state->key_pos = 0;
+      vigenere_transform_into((const char *)request + SERVE_HEADER_SIZE + id_len, 
+                              (char *)response + SERVE_RESPONSE_HEADER_SIZE, payload_len, key_state, (modes_t)request[0]);
+    }
+
+    const size_t response_len = response[0] == 0 ? payload_len : 0;
+
+    store_be(response + 1, response_len, 2);
+    client->output_len += SERVE_RESPONSE_HEADER_SIZE + response_len;
+    pos += request_len;
+    config->counters.requests++;
+
+    if (server->latencies != NULL) {
+      const unsigned long long bucket = (serve_clock() - start) / SERVE_LATENCY_WIDTH;
+      server->latencies[bucket < SERVE_LATENCY_BUCKETS ? bucket : SERVE_LATENCY_BUCKETS - 1]++;
+    }
+  }
+
+  memmove(client->input, client->input + pos, client->input_len - pos);
+  client->input_len -= pos;
+}
+
+// Closes the client, freeing its slot (although its buffers are kept for the next client).
+static void
+serve_close(server_t *server, serve_client_t *client) {
+  epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+  close(client->fd);
+  client->fd = -1;
+}
+
+/**
+* This function services a client whose socket is readable or writable - the output is
+* written first, following which requests are read (and transformed) until the socket is
+* drained. Whilst output remains unwritten, the client is watched for writability alone,
+* such that a client which does not read its responses cannot grow the output.
+*/
+static void
+serve_client(server_t *server, serve_client_t *client) {
+  for (;;) {
+    while (client->output_pos < client->output_len) {
+      const ssize_t sent = send(client->fd, client->output + client->output_pos, 
+                                client->output_len - client->output_pos, MSG_NOSIGNAL);
+
+      if (sent < 0 && errno == EINTR) continue;
+      if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        struct epoll_event event = { EPOLLOUT, { .ptr = client } };
+
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+        return;
+      }
+      if (sent <= 0) {
+        serve_close(server, client);
+        return;
+      }
+
+      client->output_pos += (size_t)sent;
+    }
+
+    client->output_len = client->output_pos = 0;
+
+    const ssize_t received = recv(client->fd, client->input + client->input_len, 
+                                  SERVE_BUFFER_SIZE - client->input_len, 0);
+
+    if (received < 0 && errno == EINTR) continue;
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      struct epoll_event event = { EPOLLIN, { .ptr = client } };
+
+      epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+      return;
+    }
+    if (received <= 0) {
+      serve_close(server, client);
+      return;
+    }
+
+    client->input_len += (size_t)received;
+    serve_requests(server, client);
+  }
+}
+
+// Accepts every pending client, each into a free slot (or closing it, should there be none).
+static void
+serve_accept(server_t *server) {
+  int client_fd;
+
+  while ((client_fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    serve_client_t *client = NULL;
+
+    for (size_t slot_ctr = 0; slot_ctr < SERVE_CONNECTIONS && client == NULL; slot_ctr++)
+      if (server->clients[slot_ctr].fd == -1) client = &server->clients[slot_ctr];
+
+    if (client == NULL) {
+      close(client_fd);
+      continue;
+    }
+
+    if (client->input == NULL) {
+      client->input = (unsigned char *)alloc_buffer(&server->config->arena, SERVE_BUFFER_SIZE, "a client's buffers");
+      client->output = (unsigned char *)alloc_buffer(&server->config->arena, SERVE_BUFFER_SIZE, "a client's buffers");
+    }
+
+    struct epoll_event event = { EPOLLIN, { .ptr = client } };
+
+    client->fd = client_fd;
+    client->input_len = client->output_len = client->output_pos = 0;
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, client_fd, &event) != 0) serve_close(server, client);
+  }
+}
+
+// Returns the upper bound of the bucket containing the given percentile of the latencies.
+static size_t
+serve_percentile(const size_t *latencies, size_t requests, double percentile) {
+  const size_t target = (size_t)(percentile * (double)requests);
+  size_t seen = 0;
+
+  for (size_t bucket_ctr = 0; bucket_ctr < SERVE_LATENCY_BUCKETS; bucket_ctr++)
+    if ((seen += latencies[bucket_ctr]) > target) return (bucket_ctr + 1) * SERVE_LATENCY_WIDTH;
+
+  return SERVE_LATENCY_BUCKETS * SERVE_LATENCY_WIDTH;
+}
+
+#endif
+
+/**
+* This function serves requests upon a Unix domain socket ("--serve"), until interrupted
+* (SIGINT/SIGTERM), whereupon the statistics (should "--stats" be specified) report the
+* latency of the requests - that is, the time taken to transform each, as opposed to the
+* round trip (which is dominated by the socket itself).
+*
+* The server is a single-threaded, level-triggered epoll loop, hence requests are never
+* queued behind a lock. Every buffer is allocated once, an input and output buffer per
+* client slot, and the keys are prepared upon first use (see serve_requests()).
+*/
+static void
+serve_message(config_t *config) {
+#ifdef VIGENERE_SERVE
+  server_t *server = (server_t *)alloc_buffer(&config->arena, sizeof(server_t), "the server");
+  struct sockaddr_un address;
+  struct stat socket_stat;
+
+  memset(server, 0, sizeof(*server));
+  memset(&address, 0, sizeof(address));
+  server->config = config;
+  for (size_t slot_ctr = 0; slot_ctr < SERVE_CONNECTIONS; slot_ctr++) server->clients[slot_ctr].fd = -1;
+
+  if (config->stats) {
+    server->latencies = (size_t *)alloc_buffer(&config->arena, SERVE_LATENCY_BUCKETS * sizeof(size_t), "the latencies");
+    memset(server->latencies, 0, SERVE_LATENCY_BUCKETS * sizeof(size_t));
+  }
+
+  if (config->keys_path != NULL) {
+    config->keyring = (keyring_t *)alloc_buffer(&config->arena, sizeof(keyring_t), "the keyring");
+    load_keyring(config->keyring, config->keys_path, &config->arena);
+    config->keyring->alphabet = config->alphabet;
+    config->keyring->cipher = config->cipher;
+  }
+
+  if (strlen(config->serve_path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "error: the socket path '%s' is too long.\n", config->serve_path);
+    exit(EXIT_FAILURE);
+  }
+
+  // A socket left behind by a previous server is replaced, although any other file is not.
+  if (lstat(config->serve_path, &socket_stat) == 0 && S_ISSOCK(socket_stat.st_mode)) unlink(config->serve_path);
+
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, config->serve_path, strlen(config->serve_path));
+
+  struct epoll_event event = { EPOLLIN, { .ptr = NULL } };
+
+  if ((server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 || 
+      bind(server->listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || 
+      listen(server->listen_fd, SOMAXCONN) != 0 || (server->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0 || 
+      epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event) != 0) {
+    fprintf(stderr, "error: unable to listen upon '%s'.\n", config->serve_path);
+    exit(EXIT_FAILURE);
+  }
+
+  // The handlers are installed without SA_RESTART, so that epoll_wait() is interrupted.
+  struct sigaction action;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = serve_stop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  struct epoll_event events[SERVE_CONNECTIONS + 1];
+
+  while (!serve_stopped) {
+    const int event_count = epoll_wait(server->epoll_fd, events, SERVE_CONNECTIONS + 1, -1);
+
+    if (event_count < 0 && errno != EINTR) {
+      fprintf(stderr, "error: unable to wait upon '%s'.\n", config->serve_path);
+      exit(EXIT_FAILURE);
+    }
+
+    for (int event_ctr = 0; event_ctr < event_count; event_ctr++) {
+      serve_client_t *client = (serve_client_t *)events[event_ctr].data.ptr;
+
+      if (client == NULL) serve_accept(server);
+      else if (client->fd != -1) serve_client(server, client);
+    }
+  }
+
+  for (size_t slot_ctr = 0; slot_ctr < SERVE_CONNECTIONS; slot_ctr++)
+    if (server->clients[slot_ctr].fd != -1) serve_close(server, &server->clients[slot_ctr]);
+
+  close(server->epoll_fd);
+  close(server->listen_fd);
+  unlink(config->serve_path);
+
+  if (config->keyring != NULL) {
+    config->counters.cache_hits = config->keyring->hits;
+    config->counters.cache_misses = config->keyring->misses;
+  }
+
+  if (server->latencies != NULL && config->counters.requests > 0) {
+    config->counters.latency_p50 = serve_percentile(server->latencies, config->counters.requests, 0.50);
+    config->counters.latency_p99 = serve_percentile(server->latencies, config->counters.requests, 0.99);
+
+    for (size_t bucket_ctr = 0; bucket_ctr < SERVE_LATENCY_BUCKETS; bucket_ctr++)
+      if (server->latencies[bucket_ctr] > 0) config->counters.latency_max = (bucket_ctr + 1) * SERVE_LATENCY_WIDTH;
+  }
+#else
+  (void)config;
+  fprintf(stderr, "error: --serve is unavailable upon this platform.\n");
+  exit(EXIT_FAILURE);
+#endif
+}
+
+// Prints the candidate keys (from the analysis or the search), one per line.
+static void
+print_candidates(const vigenere_candidate_t *candidates, size_t candidate_count) {
+  printf("%-6s %6s %8s %8s  %s\n", "rank", "period", "ioc", "score", "key");
+
+  for (size_t candidate_ctr = 0; candidate_ctr < candidate_count; candidate_ctr++)
+    printf("%-6zu %6zu %8.4f %8.4f  %s\n", candidate_ctr + 1, candidates[candidate_ctr].period, 
+           candidates[candidate_ctr].ioc, candidates[candidate_ctr].score, candidates[candidate_ctr].key);
+}
+
+/**
+* This function analyses the message ("-a"), recovering the most likely keys.
+*
+* The message (or stream) is passed through the analysis once, in chunks, which
+* accumulates the letter counts of every coset of every period - the ciphertext is
+* therefore never held in its entirety, and may be of any size. The key length is
+* then indicated by the index of coincidence, and each letter of the key recovered
+* by fitting its coset to the frequencies of English (see vigenere_analysis_rank()).
+*/
+static void
+analyze_message(config_t *config) {
+  vigenere_analysis_t *analysis = vigenere_analysis_init(config->max_period);
+  vigenere_candidate_t candidates[ANALYSIS_CANDIDATES];
+
+  if (analysis == NULL) {
+    fprintf(stderr, "error: unable to allocate the analysis.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (strncmp(config->message, "-", 2) == 0) {
+    FILE *input = stdin, *output = stdout;
+    char *chunk = (char *)alloc_buffer(&config->arena, sizeof(char) * STREAM_CHUNK_SIZE, "the stream buffer");
+    size_t bytes_read = 0;
+
+    open_streams(config, &input, &output);
+    while ((bytes_read = fread(chunk, sizeof(char), STREAM_CHUNK_SIZE, input)) > 0)
+      vigenere_analysis_update(analysis, chunk, bytes_read);
+    close_streams(input, output);
+  } else vigenere_analysis_update(analysis, config->message, config->message_len);
+
+  const size_t candidate_count = vigenere_analysis_rank(analysis, candidates, ANALYSIS_CANDIDATES);
+
+  if (candidate_count == 0) {
+    fprintf(stderr, "error: too few letters to analyse (%zu).\n", vigenere_analysis_letters(analysis));
+    exit(EXIT_FAILURE);
+  }
+
+  printf("letters: %zu, estimated key length (friedman): %.1f\n", 
+         vigenere_analysis_letters(analysis), vigenere_analysis_friedman(analysis));
+  print_candidates(candidates, candidate_count);
+
+  vigenere_analysis_free(analysis);
+}
+
+/**
+* This function searches for the key of the message ("-s"), trying each key of the
+* wordlist ("-w"), or every key of up to config->max_length letters ("-l").
+*
+* Only the first SEARCH_SAMPLE_SIZE bytes of the message are read, of which only the
+* first few hundred letters are deciphered by each attempt (see vigenere_search()).
+* Should a key reach the threshold, the search terminates early.
+*/
+static void
+search_message(config_t *config) {
+  vigenere_search_t search;
+  vigenere_candidate_t candidates[ANALYSIS_CANDIDATES];
+  vigenere_model_t *model = NULL;
+  char *sample = config->message, *wordlist = NULL;
+  const char **keys = NULL;
+  size_t sample_len = config->message_len;
+
+  if (config->model_path != NULL) {
+    size_t model_len = 0;
+    char *ngrams = read_file(&config->arena, config->model_path, &model_len);
+
+    if ((model = vigenere_model_ngrams(ngrams, model_len)) == NULL) {
+      fprintf(stderr, "error: invalid n-grams within '%s'.\n", config->model_path);
+      exit(EXIT_FAILURE);
+    }
+  } else model = vigenere_model_english();
+
+  memset(&search, 0, sizeof(search));
+  search.max_length = config->max_length;
+  search.threads = config->threads;
+  search.threshold = config->threshold;
+
+  // The wordlist is split into its lines in place, with blank lines skipped.
+  if (config->wordlist_path != NULL) {
+    size_t wordlist_len = 0, line_count = 1;
+
+    wordlist = read_file(&config->arena, config->wordlist_path, &wordlist_len);
+    for (size_t char_ctr = 0; char_ctr < wordlist_len; char_ctr++) line_count += wordlist[char_ctr] == '\n';
+
+    keys = (const char **)alloc_buffer(&config->arena, sizeof(char *) * line_count, "the wordlist");
+
+    for (char *line = wordlist, *next = NULL; line != NULL && *line != '\0'; line = next) {
+      if ((next = strchr(line, '\n')) != NULL) *next++ = '\0';
+      line[strcspn(line, "\r")] = '\0';
+      if (*line != '\0') keys[search.key_count++] = line;
+    }
+
+    search.keys = keys;
+  }
+
+  if (strncmp(config->message, "-", 2) == 0) {
+    FILE *input = stdin, *output = stdout;
+
+    sample = (char *)alloc_buffer(&config->arena, sizeof(char) * SEARCH_SAMPLE_SIZE, "the stream buffer");
+    open_streams(config, &input, &output);
+    sample_len = fread(sample, sizeof(char), SEARCH_SAMPLE_SIZE, input);
+    close_streams(input, output);
+  }
+
+  if (model == NULL) {
+    fprintf(stderr, "error: unable to allocate the model.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  const size_t candidate_count = vigenere_search(model, sample, sample_len, &search, candidates, ANALYSIS_CANDIDATES);
+
+  if (candidate_count == 0) {
+    fprintf(stderr, "error: no keys were tried (too few letters, or no keys).\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("keys tried: %zu\n", search.tried);
+  print_candidates(candidates, candidate_count);
+
+  vigenere_model_free(model);
+}
+
+/**
+* This function builds the config structure.
+*
+* This accepts the parameters option, message and key,
+* and creates a config struct containing these members
+* accordingly. The optional members are assigned their defaults, which
+* parse_args() subsequently overrides as specified by the user.
+*
+* As per Separation of Concerns (SoC), it was deemed neccessary to divide
+* construction of the config structure from the application logic 
+* (i.e., within the main() function). 
+*/
+static config_t
+build_config(int option, char *message, char *key) {
+  config_t config;
+
+  // Modify members to the values passed in the function parameters.
+  config.option = option;
+  config.message = message;
+  config.message_len = strlen(message);
+  config.key = key;
+
+  // Optional members (see parse_args()).
+  config.key_path = NULL;
+  config.key_env = NULL;
+  config.input_path = NULL;
+  config.output_path = NULL;
+  config.threads = 1;
+  config.batch = NoBatch;
+  config.reset_key = 0;
+  config.keys_path = NULL;
+  config.keyring = NULL;
+  config.stats = 0;
+  config.analyze = 0;
+  config.max_period = ANALYSIS_PERIOD;
+  config.search = 0;
+  config.wordlist_path = NULL;
+  config.max_length = 0;
+  config.model_path = NULL;
+  config.threshold = 0;
+  memset(&config.counters, 0, sizeof(config.counters));
+  vigenere_arena_init(&config.arena, NULL, 0);
+
+  // The shift table is generated later on (see generate_keystream()).
+  config.key_state.shifts = NULL;
+  config.key_state.key_len = 0;
+  config.key_state.key_pos = 0;
+  config.key_state.alphabet = Letters;
+  config.key_state.autokey = NULL;
+  config.key_state.cipher = Vigenere;
+  config.alphabet = Letters;
+  config.autokey = 0;
+  config.running_key_path = NULL;
+  config.running_key = NULL;
+  config.cipher = Vigenere;
+  config.uring = 0;
+  config.splice = 0;
+  config.utf8 = 0;
+  config.fold = 0;
+  vigenere_utf8_init(&config.utf8_state);
+  config.index_path = NULL;
+  config.index = NULL;
+  config.index_offset = 0;
+  config.index_count = 0;
+  config.ranged = 0;
+  config.range_begin = 0;
+  config.range_end = 0;
+  config.tree_path = NULL;
+  config.serve_path = NULL;
+  config.constant_time = 0;
+  config.decompress = NoCodec;
+  config.compress = NoCodec;
+  config.histogram_path = NULL;
+  config.histogram_file = NULL;
+  memset(&config.histogram, 0, sizeof(config.histogram));
+
+  return config;
+}
+
+/**
+* Returns non-zero should the argument be exactly the flag. The comparison is bounded by the 
+* flag (including its '\0'), so that neither a prefix of the flag (i.e., "-" of "-h") nor a
+* longer argument (i.e., "-kx") matches it.
+*/
+#define is_flag(arg, flag) (strncmp((arg), (flag), sizeof(flag)) == 0)
+
+/**
+* This function parses the command-line arguments passed in by the
+* user.
+*
+* In C, command-line arguments are accessible using argv, which together 
+* with argc, are passed into this function to parse into a config structure.
+*
+* There are alternative means to parsing command-line arguments, including getopt
+* (from unistd.h) and argp (argp.h). However, as these are part of the POSIX and
+* GNU C libraries, cross-platform compatibility is affected.
+*
+* Resultantly, this is performed manually, in a single pass over argv. The flags may be
+* supplied in any order, each compared exactly (see is_flag()) - any argument which is not
+* a flag (or the value of one) is the message, of which there must be exactly one. "-" 
+* streams the message, and "--" ends the flags (should the message itself begin with '-').
+* 
+* https://www.gnu.org/software/libc/manual/html_node/Program-Arguments.html
+*/
+static config_t 
+parse_args(int argc, char **argv) {
+  char *message = NULL, *key = NULL;
+  config_t config = build_config(Encrypt, "", NULL);
+
+  /**
+  * The number of flags pertaining to transforming the message, and to the analysis ("-p") and
+  * search ("-w", "-l", "-q", "-t") respectively - each of which is only accepted in its own mode.
+  */
+  int transform_flags = 0, analyze_flags = 0, search_flags = 0, key_sources = 0, mode_given = 0, flags_ended = 0;
+
+  // Check to identify if any arguments are supplied (via argc), otherwise the usage information is printed.
+  if (argc < 2) exit_print_info(Usage);
+
+  for (int arg_ctr = 1; arg_ctr < argc; arg_ctr++) {
+    char *arg = argv[arg_ctr];
+
+    // The message is any argument that is not a flag - including "-" itself, and anything after "--".
+    if (flags_ended || arg[0] != '-' || arg[1] == '\0') {
+      if (message != NULL) exit_print_info(Usage);
+      message = arg;
+      continue;
+    }
+
+    if (is_flag(arg, "--")) {
+      flags_ended = 1;
+      continue;
+    }
+
+    if (is_flag(arg, "-h") || is_flag(arg, "--help")) exit_print_info(Help);
+
+    // "-a" analyses the message, and "-s" searches for its key, in place of encrypting/decrypting it.
+    if (is_flag(arg, "-a")) {
+      config.analyze = 1;
+      continue;
+    } else if (is_flag(arg, "-s")) {
+      config.search = 1;
+      continue;
+    }
+
+    // The remaining flags without a value, of which "-R" resets the key at the start of each record.
+    if (is_flag(arg, "-R")) {
+      config.reset_key = 1;
+      transform_flags++;
+      continue;
+    } else if (is_flag(arg, "--stats")) {
+      config.stats = 1;
+      transform_flags++;
+      continue;
+    } else if (is_flag(arg, "--autokey")) {
+      config.autokey = 1;
+      transform_flags++;
+      continue;
+    } else if (is_flag(arg, "--utf8")) {
+      config.utf8 = 1;
+      transform_flags++;
+      continue;
+    } else if (is_flag(arg, "--fold")) {
+      config.utf8 = config.fold = 1;
+      transform_flags++;
+      continue;
+    } else if (is_flag(arg, "--constant-time")) {
+      config.constant_time = 1;
+      transform_flags++;
+      continue;
+    } else if (is_flag(arg, "--uring")) {
+      config.uring = 1;
+      transform_flags++;
+      continue;
+    } else if (is_flag(arg, "--splice")) {
+      config.splice = 1;
+      transform_flags++;
+      continue;
+    }
+
+    // Every other flag is followed by its value (i.e., "-i FILE"), and is counted as flag_count.
+    if (arg_ctr + 1 >= argc) exit_print_info(Usage);
+    char *value = argv[++arg_ctr];
+    int *flag_count = &transform_flags;
+
+    // "-m" denotes the mode of operation (that is, encrypt or decrypt).
+    if (is_flag(arg, "-m")) {
+      if (!isdigit((unsigned char)value[0])) exit_print_info(Usage);
+      config.option = (int)value[0] % 2; // Convert to binary value to support enumeration.
+      mode_given = 1;
+      flag_count = NULL;
+    }
+
+    /**
+    * "-k" denotes the key itself, whereas "--key-file" and "--key-env" denote the file and the
+    * environment variable it is read from (see load_key()) - exactly one of these is expected.
+    */
+    else if (is_flag(arg, "-k")) {
+      if (value[0] == '\0') exit_print_info(Usage);
+      key = value;
+      key_sources++;
+      flag_count = NULL;
+    }
+    else if (is_flag(arg, "--key-file")) {
+      config.key_path = value;
+      key_sources++;
+      flag_count = NULL;
+    }
+    else if (is_flag(arg, "--key-env")) {
+      config.key_env = value;
+      key_sources++;
+      flag_count = NULL;
+    }
+
+    // "-i" denotes the file to read from, "-o" the file to write to, and "-r" the directory to read from.
+    else if (is_flag(arg, "-i")) {
+      config.input_path = value;
+      flag_count = NULL; // accepted whilst analysing or searching, too.
+    }
+    else if (is_flag(arg, "-o")) config.output_path = value;
+    else if (is_flag(arg, "-r")) config.tree_path = value;
+
+    // "--serve" denotes the Unix domain socket to serve requests upon.
+    else if (is_flag(arg, "--serve")) config.serve_path = value;
+
+    // "--histogram" denotes the file the letter counts are written to.
+    else if (is_flag(arg, "--histogram")) config.histogram_path = value;
+
+    // "--histogram-sample" denotes the interval between the blocks counted (see vigenere_histogram_t).
+    else if (is_flag(arg, "--histogram-sample")) {
+      if (atoi(value) < 1) exit_print_info(Usage);
+      config.histogram.sample = (unsigned int)atoi(value);
+    }
+
+    // "-b" denotes batch mode, followed by the format of the records.
+    else if (is_flag(arg, "-b")) {
+      if (is_flag(value, "lines")) config.batch = Lines;
+      else if (is_flag(value, "prefixed")) config.batch = Prefixed;
+      else if (is_flag(value, "keyed")) config.batch = Keyed;
+      else exit_print_info(Usage);
+    }
+
+    // "-K" denotes the keys file, used by the "keyed" batch mode.
+    else if (is_flag(arg, "-K")) config.keys_path = value;
+
+    // "-j" denotes the number of threads (1 to MAX_THREADS) to transform (or search) with.
+    else if (is_flag(arg, "-j")) {
+      config.threads = atoi(value);
+      if (config.threads < 1 || config.threads > MAX_THREADS) exit_print_info(Usage);
+      flag_count = NULL; // accepted whilst searching, too.
+    }
+
+    // "--index" denotes the index file, and "--range" the range of bytes "A:B" (or "A:") to transform.
+    else if (is_flag(arg, "--index")) config.index_path = value;
+    else if (is_flag(arg, "--range")) {
+      char *end;
+
+      config.ranged = 1;
+      config.range_begin = (size_t)strtoull(value, &end, 10);
+      if (end == value || *end != ':' || value[0] == '-') exit_print_info(Usage);
+
+      value = end + 1;
+      config.range_end = *value == '\0' ? (size_t)-1 : (size_t)strtoull(value, &end, 10);
+      if ((*value != '\0' && (*end != '\0' || value[0] == '-')) || config.range_end < config.range_begin) exit_print_info(Usage);
+    }
+
+    // "--decompress" and "--compress" denote the compression formats of the input and output.
+    else if (is_flag(arg, "--decompress") || is_flag(arg, "--compress")) {
+      codecs_t *codec = arg[2] == 'd' ? &config.decompress : &config.compress;
+
+      if (is_flag(value, "gzip")) *codec = Gzip;
+      else if (is_flag(value, "zstd")) *codec = Zstd;
+      else exit_print_info(Usage);
+    }
+
+    // "--running-key" denotes the file whose text follows the key.
+    else if (is_flag(arg, "--running-key")) config.running_key_path = value;
+
+    // "-c" denotes the cipher, that is, how the key is combined with the message.
+    else if (is_flag(arg, "-c")) {
+      if (is_flag(value, "vigenere")) config.cipher = Vigenere;
+      else if (is_flag(value, "beaufort")) config.cipher = Beaufort;
+      else if (is_flag(value, "variant")) config.cipher = VariantBeaufort;
+      else if (is_flag(value, "gronsfeld")) config.cipher = Gronsfeld;
+      else exit_print_info(Usage);
+    }
+
+    // "-A" denotes the alphabet, within which the shifts are performed.
+    else if (is_flag(arg, "-A")) {
+      if (is_flag(value, "letters")) config.alphabet = Letters;
+      else if (is_flag(value, "alphanumeric")) config.alphabet = Alphanumeric;
+      else if (is_flag(value, "printable")) config.alphabet = Printable;
+      else if (is_flag(value, "bytes")) config.alphabet = Bytes;
+      else exit_print_info(Usage);
+    }
+
+    // "-p" denotes the longest key considered by the analysis.
+    else if (is_flag(arg, "-p")) {
+      config.max_period = (size_t)atoi(value);
+      if (config.max_period < 1 || config.max_period > VIGENERE_MAX_PERIOD) exit_print_info(Usage);
+      flag_count = &analyze_flags;
+    }
+
+    /**
+    * "-w" denotes the wordlist searched, "-l" the longest key searched (in place of a wordlist),
+    * "-q" the n-grams scoring the keys, and "-t" the score at which the search stops.
+    */
+    else if (is_flag(arg, "-w") || is_flag(arg, "-l") || is_flag(arg, "-q") || is_flag(arg, "-t")) {
+      if (arg[1] == 'w') config.wordlist_path = value;
+      else if (arg[1] == 'q') config.model_path = value;
+      else if (arg[1] == 'l') {
+        config.max_length = (size_t)atoi(value);
+        if (config.max_length < 1 || config.max_length > VIGENERE_MAX_SEARCH_LENGTH) exit_print_info(Usage);
+      }
+      else {
+        config.threshold = atof(value);
+        if (config.threshold <= 0) exit_print_info(Usage);
+      }
+
+      flag_count = &search_flags;
+    }
+    else exit_print_info(Usage);
+
+
+    if (flag_count != NULL) (*flag_count)++;
+  }
+
+  // The message must be supplied (and be non-empty).
+  if (message == NULL || message[0] == '\0') exit_print_info(Usage);
+
+  config.message = message;
+  config.message_len = strlen(message);
+  config.key = key;
+
+  const int streaming = is_flag(message, "-");
+
+  /**
+  * Analysing (and searching) requires neither the mode nor the key, and accepts only "-i"
+  * (and "-p"), whereas searching also accepts "-w", "-l", "-q", "-t" and "-j" (of which
+  * one of "-w" and "-l" is required).
+  */
+  if (config.analyze || config.search) {
+    if ((config.analyze && config.search) || transform_flags > 0 || key_sources > 0 || mode_given || 
+        (config.analyze && (search_flags > 0 || config.threads > 1)) || (config.search && analyze_flags > 0) ||
+        (config.input_path != NULL && !streaming)) exit_print_info(Usage);
+    if (config.search && (config.wordlist_path != NULL) == (config.max_length != 0)) exit_print_info(Usage);
+    return config;
+  }
+
+  // Otherwise, exactly one key is expected (see load_key()), and neither the analysis nor search flags.
+  if (key_sources != 1 || analyze_flags > 0 || search_flags > 0) exit_print_info(Usage);
+
+  /**
+  * "-i", "-o", "-r", "-b", "-R", "-K" and the like are only meaningful whilst streaming, hence the
+  * usage information is printed should these accompany a message supplied within argv.
+  */
+  if (!streaming && (config.input_path != NULL || config.output_path != NULL || config.tree_path != NULL || 
+                     config.serve_path != NULL || config.batch != NoBatch || config.reset_key || config.keys_path != NULL || 
+                     config.index_path != NULL || config.ranged || config.uring || config.splice || 
+                     config.decompress != NoCodec || config.compress != NoCodec)) exit_print_info(Usage);
+
+  // The "keyed" batch mode requires a keys file, which is otherwise meaningless (other than whilst serving).
+  if ((config.batch == Keyed) != (config.keys_path != NULL) && config.serve_path == NULL) exit_print_info(Usage);
+
+  /**
+  * Whilst serving, each request holds its own mode and message (which starts at the beginning
+  * of its key), hence none of the options pertaining to a single message are accepted.
+  */
+  if (config.serve_path != NULL && (config.input_path != NULL || config.output_path != NULL || config.batch != NoBatch || 
+                                    config.autokey || config.running_key_path != NULL || config.utf8 || 
+                                    config.index_path != NULL || config.ranged || config.uring || config.splice || 
+                                    config.tree_path != NULL || config.threads > 1)) exit_print_info(Usage);
+
+  /**
+  * The key may be followed by either the plaintext or a file, but not both - as neither
+  * repeats, these transform the message as a whole, hence not within batch mode.
+  */
+  if ((config.autokey || config.running_key_path != NULL) && 
+      ((config.autokey && config.running_key_path != NULL) || config.batch != NoBatch)) exit_print_info(Usage);
+
+  // Shifting every byte would corrupt the multibyte characters, and records are not validated.
+  if (config.utf8 && (config.alphabet == Bytes || config.batch != NoBatch)) exit_print_info(Usage);
+
+  // Records are transformed as they are read, hence the batch modes are never overlapped (or spliced).
+  if ((config.uring || config.splice) && (config.batch != NoBatch || (config.uring && config.splice))) exit_print_info(Usage);
+
+  /**
+  * The key position of a range is that of a repeating key, and the index is of the message as
+  * a whole - hence neither applies to records, and a range is never validated (nor folded).
+  */
+  if (config.index_path != NULL && config.batch != NoBatch) exit_print_info(Usage);
+  /**
+  * Each file of a directory is transformed as a whole from the start of a repeating key, and
+  * into the output directory - as such, "-r" accepts neither "-i" nor the modes of a single message.
+  */
+  if (config.tree_path != NULL && (config.output_path == NULL || config.input_path != NULL || config.batch != NoBatch || 
+                                   config.autokey || config.running_key_path != NULL || config.utf8 || 
+                                   config.index_path != NULL || config.ranged || config.uring || config.splice)) exit_print_info(Usage);
+  if (config.ranged && (config.autokey || config.running_key_path != NULL || config.utf8 || 
+                        config.uring || config.splice || config.batch != NoBatch)) exit_print_info(Usage);
+
+  /**
+  * Only the 26-letter alphabet has constant-time kernels - the extended alphabets, autokeys
+  * and the UTF-8 validation each branch upon the characters of the message.
+  */
+  if (config.constant_time && (config.alphabet != Letters || config.autokey || config.utf8)) exit_print_info(Usage);
+
+  /**
+  * The compressed pipeline streams the message as a whole - as such, it neither reads records, 
+  * seeks (nor maps) the input, nor folds (which would shorten the blocks between the stages).
+  */
+  if ((config.decompress != NoCodec || config.compress != NoCodec) && 
+      (config.batch != NoBatch || config.fold || config.ranged || config.uring || config.splice || 
+       config.tree_path != NULL || config.serve_path != NULL)) exit_print_info(Usage);
+
+  // The histogram is of the message as a whole, rather than of records, files or requests.
+  if (config.histogram_path != NULL && (config.batch != NoBatch || config.tree_path != NULL || 
+                                        config.serve_path != NULL)) exit_print_info(Usage);
+  if (config.histogram.sample != 0 && config.histogram_path == NULL) exit_print_info(Usage);
+
+  return config; 
+}
+
+/**
+* The main entry point of the program.
+* 
+* Here, argc and argv are passed in as arguments, allowing
+* users to supply command-line arguments in addition to the compiled
+* file. i.e., ./vigenere -h 
+*
+* This function was written with Separation of Concerns (SoC) in mind,
+* with the main function containing as little application logic as 
+* needed to function. All other logic is encapsulated within other
+* functions.
+*/
+int 
+main(int argc, char **argv) {
+
+#ifdef VIGENERE_STATS
+  phase_t parse_phase = { 0 }, total_phase = { 0 };
+
+  phase_begin(&total_phase);
+  phase_begin(&parse_phase);
+#endif
+
+  // Passing the command-line arguments into parse_args for further processing.
+  config_t config = parse_args(argc, argv);
+
+  /**
+  * Every buffer of the run is allocated from the arena, which is backed by a static
+  * buffer - upon completion, the arena (and everything within it) is released at once.
+  */
+  static unsigned char arena_buffer[ARENA_BUFFER_SIZE];
+  vigenere_arena_init(&config.arena, arena_buffer, sizeof(arena_buffer));
+
+#ifdef VIGENERE_STATS
+  // The parse phase precedes the config structure, hence is copied in afterwards.
+  phase_end(&parse_phase);
+  config.counters.phases[Parse] = parse_phase;
+  config.counters.phases[Total] = total_phase;
+#endif
+
+  // Analysing (and searching) requires no key, hence this is performed prior to generating the keystream.
+  if (config.analyze || config.search) {
+    if (config.analyze) analyze_message(&config);
+    else search_message(&config);
+
+    vigenere_arena_release(&config.arena);
+    return EXIT_SUCCESS;
+  }
+
+  // The constant-time kernel then replaces the selected kernel for every transformation of the run.
+  if (config.constant_time) vigenere_use_constant_time();
+
+  /**
+  * The config structure is passed in to generate_keystream()
+  * as a reference (pass by reference). This allows us, within
+  * generate_keystream(), to easily modify the individual
+  * members of the config struct.
+  *
+  * This is passed in using the & notation.
+  */
+  STATS_BEGIN(&config, Keystream);
+  load_key(&config);
+  generate_keystream(&config);
+  if (config.running_key_path != NULL) open_running_key(&config);
+  STATS_END(&config, Keystream);
+  
+  /**
+  * Should the message be "-", this is read from stdin (or the file specified
+  * via "-i") as opposed to being taken from argv. Regular files are mapped into
+  * memory, whereas pipes (and the like) are streamed.
+  */
+  if (config.histogram_path != NULL) open_histogram(&config);
+
+  if (strncmp(config.message, "-", 2) == 0) {
+    if (config.index_path != NULL && !config.ranged) open_index(&config);
+
+    if (config.serve_path != NULL) serve_message(&config);
+    else if (config.decompress != NoCodec || config.compress != NoCodec) pipeline_message(&config);
+    else if (config.tree_path != NULL) tree_message(&config);
+    else if (config.batch != NoBatch) batch_message(&config);
+    else if (config.ranged) range_message(&config);
+    else if (config.fold) stream_message(&config);
+    else if (!uring_message(&config) && !map_message(&config)) stream_message(&config);
+
+    finish_text(&config);
+    close_index(&config);
+    write_histogram(&config);
+    close_running_key(&config);
+    if (config.stats) print_stats(&config);
+    vigenere_arena_release(&config.arena);
+    return EXIT_SUCCESS;
+  }
+
+  /**
+  * The message is transformed in place - as argv is writable, there is
+  * no need to allocate a separate output buffer (folding only shortens it).
+  */
+  if (config.fold) {
+    validate_text(&config, config.message, config.message_len);
+    config.message_len = vigenere_utf8_fold(config.message, config.message_len);
+  }
+
+  STATS_TRANSFORMED(&config, config.message, config.message_len);
+  STATS_BEGIN(&config, Transform);
+  transform_text(&config, config.message, config.message, config.message_len);
+  STATS_END(&config, Transform);
+  finish_text(&config);
+  write_histogram(&config);
+
+  /**
+  * Print the resulting output to stdout - as the byte alphabet may produce '\0', this is
+  * written using its length, rather than as a string.
+  */
+  fwrite(config.message, sizeof(char), config.message_len, stdout);
+  putchar('\n');
+  close_running_key(&config);
+  if (config.stats) print_stats(&config);
+  vigenere_arena_release(&config.arena);
 
   /**
   * Voluntarily exit successfully using the constant EXIT_SUCCESS,
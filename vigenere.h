@@ -0,0 +1,464 @@
+/**
+ * Copyright (C) 2023 Ryan Instrell - All rights reserved.
+ *
+ * libvigenere - the cipher itself, separated from the command-line interface
+ * (vigenere.c) so that it may be linked into other programs.
+ *
+ * Two interfaces are provided:
+ *
+ * 1. A streaming context (vigenere_init(), vigenere_update(), vigenere_reset(),
+ *    vigenere_free()), which manages the key on the caller's behalf.
+ * 2. The underlying transformations (vigenere_transform() and friends), which
+ *    operate upon a key_state_t supplied (and owned) by the caller, and never
+ *    allocate.
+ */
+#ifndef VIGENERE_H
+#define VIGENERE_H
+
+/**
+* Provides the size_t type, used for the lengths of buffers and keys.
+*
+* https://cplusplus.com/reference/cstddef/
+*/
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The number of shifts replicated past the end of the shift table.
+ *
+ * The vectorised kernels load up to 32 contiguous shifts starting from any
+ * key position (twice, at most 16 shifts apart). Repeating the start of the key
+ * after its end (i.e., KEY -> KEYKEYKEY...) allows this without wrapping.
+ */
+#define KEY_RING_PADDING 64
+
+/**
+ * The maximum number of threads supported by vigenere_transform_parallel().
+ */
+#define MAX_THREADS 64
+
+/**
+ * Stores convenient constants to delineate the mode of operation -
+ * that is, encrypt and decrypt.
+ *
+ * The reason for utilising an enum was because due to the assignment of
+ * integral values to these constants, allowing the easy comparison of the mode.
+ *
+ * Ex. if(Encrypt) { ... } / if(Decrypt) { ... }
+ */
+typedef enum modes { Encrypt = 0, Decrypt } modes_t;
+
+/**
+ * The alphabets (symbol sets) within which the shifts are performed. Characters outside
+ * of the alphabet are left untouched, and do not advance the key.
+ *
+ * Letters = A-Z (26), whereby case is preserved - the default, and the fastest.
+ * Alphanumeric = A-Z followed by 0-9 (36). As the alphabet holds a single case, lowercase
+ *                letters are treated as (and become) uppercase.
+ * Printable = the printable ASCII characters, ' ' to '~' (95).
+ * Bytes = every byte (256), such that the cipher becomes an additive stream over bytes.
+ */
+typedef enum alphabets { Letters = 0, Alphanumeric, Printable, Bytes } alphabet_t;
+
+/**
+ * The ciphers of the Vigenere family, each of which combines the message (M) and key (K)
+ * differently - all of which share the same kernels, which are simply parameterised.
+ *
+ * Vigenere = M + K (decrypted by C - K), Beaufort = K - M (its own inverse),
+ * VariantBeaufort = M - K (decrypted by C + K), and Gronsfeld = M + K, whereby the key
+ * consists of digits (0-9), each shifting by its value (see vigenere_fill_gronsfeld_shifts()).
+ */
+typedef enum ciphers { Vigenere = 0, Beaufort, VariantBeaufort, Gronsfeld } cipher_t;
+
+/**
+ * This structure holds the state of the key whilst transforming text.
+ *
+ * Grouping the shift table together with the current position allows the
+ * transformation to be resumed at any point (i.e., the next chunk or record),
+ * as the position is simply carried within this structure.
+ *
+ * Should autokey be non-NULL, the key is followed by the plaintext itself (an autokey,
+ * i.e., KEY -> KEYATTACKATDAWN), rather than repeating. autokey then holds the next
+ * key_len shifts (initially a copy of the first key_len shifts), each of which is
+ * replaced by that of the plaintext character it transforms - the state thus remains
+ * key_len bytes, however long the message. Shifts need not be padded in this case, as
+ * autokeys are transformed one character at a time.
+ */
+typedef struct key_state {
+  const unsigned char *shifts; // per-character shifts (0-25), followed by KEY_RING_PADDING repeats.
+  size_t key_len; // number of entries within shifts (i.e., the length of the key).
+  size_t key_pos; // index of the next shift to apply.
+  alphabet_t alphabet; // the alphabet of the shifts (Letters unless otherwise specified).
+  unsigned char *autokey; // the ring of the next key_len shifts of an autokey, otherwise NULL.
+  cipher_t cipher; // the cipher the shifts are applied by (Vigenere unless otherwise specified).
+} key_state_t;
+
+/**
+ * The alignment (in bytes) of every allocation from an arena - that of a cache line, such
+ * that the buffers suit the vectorised kernels, and are never split between threads.
+ *
+ * The size of the blocks allocated by an arena once the backing buffer (if any) has been
+ * exhausted, unless a larger allocation is requested.
+ */
+#define VIGENERE_ARENA_ALIGNMENT 64
+#define VIGENERE_ARENA_BLOCK_SIZE (64 * 1024)
+
+/**
+ * An arena (bump allocator), from which the buffers of a run are allocated, and then
+ * released together - individual allocations are never freed.
+ *
+ * The arena consists of a chain of blocks, the first of which may be a buffer supplied by
+ * the caller (see vigenere_arena_init()). Should the blocks be exhausted, another block is
+ * allocated using malloc() - a sufficiently large backing buffer therefore ensures that
+ * malloc() is never called. Resetting the arena is O(1), whereby its blocks are reused.
+ */
+typedef struct vigenere_arena_block {
+  struct vigenere_arena_block *next; // the following block, or NULL.
+  size_t capacity; // the number of bytes available within the block (following this header).
+  int owned; // non-zero should the block have been allocated by the arena (i.e., not the caller).
+} vigenere_arena_block_t;
+
+typedef struct vigenere_arena {
+  vigenere_arena_block_t *first; // the first block, or NULL.
+  vigenere_arena_block_t *current; // the block being allocated from, or NULL.
+  size_t used; // the number of bytes allocated from the current block.
+} vigenere_arena_t;
+
+// A position within an arena, to which it may be rewound (see vigenere_arena_rewind()).
+typedef struct vigenere_arena_mark {
+  vigenere_arena_block_t *block;
+  size_t used;
+} vigenere_arena_mark_t;
+
+/**
+ * Initialises an arena, optionally backed by buffer (of len bytes), which must outlive the
+ * arena. buffer may be NULL, whereby every block is allocated by the arena.
+ */
+void vigenere_arena_init(vigenere_arena_t *arena, void *buffer, size_t len);
+
+/**
+ * Allocates size bytes (aligned to VIGENERE_ARENA_ALIGNMENT) from the arena, or returns NULL
+ * should a block need to be allocated and malloc() fail.
+ */
+void *vigenere_arena_alloc(vigenere_arena_t *arena, size_t size);
+
+// Returns the current position of the arena, such that the subsequent allocations may be undone.
+vigenere_arena_mark_t vigenere_arena_mark(const vigenere_arena_t *arena);
+
+// Undoes every allocation since the mark was taken, in O(1).
+void vigenere_arena_rewind(vigenere_arena_t *arena, vigenere_arena_mark_t mark);
+
+// Undoes every allocation, in O(1) - the blocks are retained for reuse.
+void vigenere_arena_reset(vigenere_arena_t *arena);
+
+// Frees the blocks allocated by the arena (but not the backing buffer), leaving it empty.
+void vigenere_arena_release(vigenere_arena_t *arena);
+
+/**
+ * The streaming context, whose members are private to the library - it is only
+ * ever handled through a pointer returned by vigenere_init().
+ */
+typedef struct vigenere_ctx vigenere_ctx_t;
+
+/**
+ * Creates a context for the key (ASCII, non-empty) and mode, or returns NULL should
+ * the key be empty or the allocation fail. The context is released by vigenere_free().
+ */
+vigenere_ctx_t *vigenere_init(const char *key, modes_t mode);
+
+/**
+ * Transforms len bytes of input into output (which may be the same buffer), continuing
+ * from where the previous call finished. Returns the updated key position.
+ */
+size_t vigenere_update(vigenere_ctx_t *ctx, const char *input, char *output, size_t len);
+
+/**
+ * As vigenere_init(), but the context (and its shift table) are allocated from the arena,
+ * whereby vigenere_free() does nothing - the context lasts until the arena is reset (or
+ * rewound past it) or released. Other buffers of the run (i.e., each record) may then be
+ * allocated from the same arena, and undone between records using a mark.
+ */
+vigenere_ctx_t *vigenere_init_arena(const char *key, modes_t mode, vigenere_arena_t *arena);
+
+// Restarts the context at the beginning of its key (i.e., for the next message).
+void vigenere_reset(vigenere_ctx_t *ctx);
+
+// Releases a context created by vigenere_init() (NULL, or a context within an arena, is ignored).
+void vigenere_free(vigenere_ctx_t *ctx);
+
+/**
+ * Fills shifts with the shift for each of the key_len characters of key, followed by
+ * KEY_RING_PADDING repeated shifts - shifts must be (at least) key_len + KEY_RING_PADDING
+ * bytes. The result is suitable for key_state_t.shifts.
+ */
+void vigenere_fill_shifts(const char *key, size_t key_len, unsigned char *shifts);
+
+/**
+ * Similarly, fills shifts for a key within the given alphabet, whereby each character
+ * shifts by its position within the alphabet (i.e., '0' = 26 for Alphanumeric). The
+ * key_state_t using the shifts must be of the same alphabet.
+ */
+void vigenere_fill_shifts_alphabet(const char *key, size_t key_len, alphabet_t alphabet, unsigned char *shifts);
+
+/**
+ * Similarly, fills shifts for a Gronsfeld key, that is, one of digits (i.e., "31415"), each
+ * of which shifts by its value. Returns 0, or -1 should the key contain any other character.
+ */
+int vigenere_fill_gronsfeld_shifts(const char *key, size_t key_len, unsigned char *shifts);
+
+/**
+ * Transforms buf (of length len) in place, continuing from key_state->key_pos.
+ * Returns the updated key position (which is also stored within key_state).
+ */
+size_t vigenere_transform(char *buf, size_t len, key_state_t *key_state, modes_t mode);
+
+// As vigenere_transform(), but writes the result to output, leaving input untouched.
+size_t vigenere_transform_into(const char *input, char *output, size_t len, key_state_t *key_state, modes_t mode);
+
+/**
+ * As vigenere_transform_into(), but splits the buffer between (up to MAX_THREADS) threads.
+ * The output is identical to that of a single thread.
+ *
+ * Compiled with -DVIGENERE_OPENCL, buffers of at least 64 MiB are instead transformed upon
+ * a GPU, should one be present (and faster than the processor).
+ */
+size_t vigenere_transform_parallel(const char *input, char *output, size_t len, key_state_t *key_state,
+                                   modes_t mode, int threads);
+
+/**
+ * The letter counts (A-Z, whereby case is folded) of the input and output of a transformation,
+ * gathered by vigenere_transform_histogram(). Each is added to by every call, hence the counts
+ * of a message transformed in pieces are those of the message as a whole.
+ *
+ * Counting every letter costs about as much as the transformation itself. Should sample be
+ * set (prior to the first call), only one block of 4 KiB in every sample is counted instead -
+ * estimating the letter frequencies (and the index of coincidence) for a fraction of the cost.
+ */
+typedef struct vigenere_histogram {
+  unsigned long long input[26]; // the letters of the input (i.e., the plaintext whilst encrypting).
+  unsigned long long output[26]; // the letters of the output.
+  unsigned int sample; // one block in every sample is counted (0 or 1 = every block).
+  unsigned long long blocks; // the blocks transformed thus far, from which sampling continues.
+  unsigned long long counted; // the characters of the blocks counted.
+} vigenere_histogram_t;
+
+/**
+ * As vigenere_transform_parallel(), but also adds the letters of input and output to histogram.
+ * These are recorded by the kernel whilst transforming (and tallied one block at a time, whilst
+ * it remains within the cache), and by each thread separately - the counts are merged once the
+ * threads are joined.
+ */
+size_t vigenere_transform_histogram(const char *input, char *output, size_t len, key_state_t *key_state,
+                                    modes_t mode, int threads, vigenere_histogram_t *histogram);
+
+// Returns the index of coincidence of the (26) letter counts, or 0 should there be fewer than 2 letters.
+double vigenere_histogram_ioc(const unsigned long long *counts);
+
+// Returns the number of letters (A-Z, a-z) within text, that is, those which advance the key.
+size_t vigenere_count(const char *text, size_t len);
+
+// Similarly, returns the number of characters of text within the alphabet.
+size_t vigenere_count_alphabet(const char *text, size_t len, alphabet_t alphabet);
+
+/**
+ * Stores the shift of each character of text within the alphabet (skipping the others)
+ * within shifts, stopping once count shifts have been stored - this prepares a running
+ * key (one as long as the message) from a text, one piece at a time.
+ *
+ * Returns the number of shifts stored, and the number of characters of text consumed
+ * through consumed.
+ */
+size_t vigenere_extract_shifts(const char *text, size_t len, alphabet_t alphabet, unsigned char *shifts,
+                               size_t count, size_t *consumed);
+
+/**
+ * The state of a UTF-8 validation, which may be performed upon a text one piece at a time
+ * (i.e., chunk by chunk), whereby a character may span the pieces.
+ *
+ * Non-ASCII characters are never letters, hence these are already passed through (without
+ * advancing the key) by every transformation - validating simply ensures that the text is
+ * UTF-8, such that the output is as well.
+ */
+typedef struct vigenere_utf8 {
+  size_t offset; // the number of bytes validated, or upon failure, the offset of the invalid byte.
+  unsigned int pending; // the continuation bytes expected by the character spanning the pieces.
+  unsigned char lower, upper; // the range of the next continuation byte (excluding overlong forms).
+} vigenere_utf8_t;
+
+// Initialises the state of a UTF-8 validation.
+void vigenere_utf8_init(vigenere_utf8_t *utf8);
+
+/**
+ * Validates the next len bytes of text, returning 0, or -1 should these not be UTF-8 (whereby
+ * utf8->offset holds the offset of the invalid byte). Blocks of 32 ASCII bytes are skipped
+ * using the selected kernel (i.e., AVX2), hence mostly-ASCII text is validated at SIMD speed.
+ */
+int vigenere_utf8_validate(vigenere_utf8_t *utf8, const char *text, size_t len);
+
+// Returns 0 should the text validated thus far end upon a complete character, otherwise -1.
+int vigenere_utf8_finish(const vigenere_utf8_t *utf8);
+
+/**
+ * Returns the length of the longest prefix of text (of len bytes) that does not end within a
+ * character - that is, len, less the bytes of an incomplete character at the end (if any).
+ */
+size_t vigenere_utf8_boundary(const char *text, size_t len);
+
+/**
+ * Folds the accented Latin letters (U+00C0 - U+017F, i.e., 'é') of text to their base
+ * letter ('e') in place, such that these are enciphered as letters. As each is encoded using
+ * two bytes, the text shrinks - the new length is returned. text should be valid UTF-8.
+ */
+size_t vigenere_utf8_fold(char *text, size_t len);
+
+/**
+ * Returns the name of the kernel used by the transformations (i.e., "avx2"), which is
+ * selected upon first use as the fastest supported by the processor.
+ */
+const char *vigenere_kernel(void);
+
+/**
+ * Returns the name of the index-th kernel supported by the processor (or NULL past the
+ * final kernel), including the original "ctype" loop - primarily for benchmarking.
+ */
+const char *vigenere_kernel_name(size_t index);
+
+/**
+ * Forces the kernel with the given name to be used. Returns 0 upon success, or -1 should
+ * the kernel be unknown or unsupported. This must not be called whilst transforming.
+ */
+int vigenere_use_kernel(const char *name);
+
+/**
+ * Switches to the constant-time counterpart of the selected kernel (i.e., "avx2-ct"), which
+ * neither branches upon the characters nor looks them up in tables - the time taken then
+ * depends upon the length of the message alone (and, at the granularity of a cache line,
+ * the key position). This applies to the 26-letter alphabet without an autokey, as the 
+ * extended alphabets and autokeys are never constant-time. Returns 0.
+ */
+int vigenere_use_constant_time(void);
+
+/**
+ * The longest key (period) which may be considered by the analysis. The cost of the
+ * analysis grows with the maximum requested - 32 periods are covered by 6 histograms
+ * per letter, whereas 64 require 20.
+ */
+#define VIGENERE_MAX_PERIOD 64
+
+/**
+ * The analysis (cryptanalysis) accumulates the letters of a ciphertext, of which the
+ * members are private to the library - see vigenere_analysis_init().
+ */
+typedef struct vigenere_analysis vigenere_analysis_t;
+
+// A key recovered by the analysis, alongside the statistics from which it was ranked.
+typedef struct vigenere_candidate {
+  char key[VIGENERE_MAX_PERIOD + 1]; // the recovered key (A-Z), terminated by '\0'.
+  size_t period; // the length of the key.
+  double ioc; // the mean index of coincidence of the cosets, or of the deciphered prefix
+              // (search) - English = ~0.066.
+  double score; // the mean chi-squared statistic per letter (analysis) or the mean negative
+                // log10-probability per n-gram (search) - lower = more English-like.
+} vigenere_candidate_t;
+
+/**
+ * Creates an analysis considering each period of 1 to max_period (at most
+ * VIGENERE_MAX_PERIOD), or returns NULL should the period be invalid or the allocation
+ * fail. The analysis is released by vigenere_analysis_free().
+ */
+vigenere_analysis_t *vigenere_analysis_init(size_t max_period);
+
+/**
+ * Accumulates len bytes of ciphertext, continuing from where the previous call finished.
+ * As with the transformations, non-alphabetic characters are skipped (they do not
+ * advance the key), hence the ciphertext may be supplied in pieces of any size.
+ */
+void vigenere_analysis_update(vigenere_analysis_t *analysis, const char *text, size_t len);
+
+// Returns the number of letters accumulated.
+size_t vigenere_analysis_letters(const vigenere_analysis_t *analysis);
+
+// Returns the mean index of coincidence of the cosets for the period (0 if too few letters).
+double vigenere_analysis_ioc(const vigenere_analysis_t *analysis, size_t period);
+
+/**
+ * Returns the Friedman estimate of the key length, derived from the index of coincidence
+ * of the whole ciphertext (0 should it be indistinguishable from random text).
+ */
+double vigenere_analysis_friedman(const vigenere_analysis_t *analysis);
+
+/**
+ * Recovers the most likely key for each period, storing (up to) count of them within
+ * candidates from the most to the least likely. Keys which are repetitions of a shorter
+ * key (i.e., LEMONLEMON) are omitted. Returns the number of candidates stored.
+ */
+size_t vigenere_analysis_rank(const vigenere_analysis_t *analysis, vigenere_candidate_t *candidates, size_t count);
+
+// Releases an analysis created by vigenere_analysis_init() (NULL is ignored).
+void vigenere_analysis_free(vigenere_analysis_t *analysis);
+
+/**
+ * The longest key tried by the exhaustive search (26^8 ~ 2 * 10^11 keys), and the most
+ * candidates which vigenere_search() may rank.
+ */
+#define VIGENERE_MAX_SEARCH_LENGTH 8
+#define VIGENERE_MAX_SEARCH_CANDIDATES 16
+
+/**
+ * The language model used to score the candidate keys of a search, of which the members
+ * are private to the library - see vigenere_model_english() and vigenere_model_ngrams().
+ */
+typedef struct vigenere_model vigenere_model_t;
+
+/**
+ * Creates a model of the letter frequencies of English, which requires no data but (as
+ * single letters say little about a short sample) never terminates a search early.
+ */
+vigenere_model_t *vigenere_model_english(void);
+
+/**
+ * Creates a model from the contents of an n-gram file (i.e., quadgrams), each line of which
+ * holds an n-gram and its count (i.e., "TION 13168375"). Every n-gram must be of the same
+ * length (1 to 4). Returns NULL should the contents be invalid or the allocation fail.
+ */
+vigenere_model_t *vigenere_model_ngrams(const char *text, size_t len);
+
+// Releases a model created by vigenere_model_english()/vigenere_model_ngrams().
+void vigenere_model_free(vigenere_model_t *model);
+
+/**
+ * Stores the keys tried by vigenere_search() - either each key within keys, or (should keys
+ * be NULL) every key of A-Z of 1 to max_length characters.
+ *
+ * A candidate whose score is at most threshold terminates the search early (0 = the
+ * default of the model). tried is written by vigenere_search().
+ */
+typedef struct vigenere_search {
+  const char *const *keys; // the keys to try (i.e., a wordlist), or NULL.
+  size_t key_count; // the number of keys.
+  size_t max_length; // the longest key tried should keys be NULL (at most VIGENERE_MAX_SEARCH_LENGTH).
+  int threads; // the number of threads to search with (1 to MAX_THREADS).
+  double threshold; // the score at which the search terminates early (0 = default).
+  size_t tried; // the number of keys tried (fewer than all, should it terminate early).
+} vigenere_search_t;
+
+/**
+ * Tries each key of the search against (the letters of) a short prefix of the ciphertext,
+ * storing the (up to) count best within candidates, from the most to the least likely.
+ * The score is the mean negative log10-probability of each n-gram of the deciphered
+ * prefix. Returns the number of candidates stored.
+ *
+ * Compiled with -DVIGENERE_OPENCL, searching every key of 6 or more letters scores the keys
+ * upon a GPU (should one be present), yielding the same candidates.
+ */
+size_t vigenere_search(const vigenere_model_t *model, const char *text, size_t len, vigenere_search_t *search,
+                       vigenere_candidate_t *candidates, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif